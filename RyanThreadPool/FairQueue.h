@@ -0,0 +1,131 @@
+//
+//  FairQueue.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef fairqueue_h
+#define fairqueue_h
+
+#include "RyanThreadPool.h"
+
+/*
+example:
+ using FairThreadPool = BasicThreadPool<FairQueue>;
+ FairThreadPool pool;
+ pool.setTenant(1, 4);         // 租户1权重为4，每轮最多取出4个任务
+ pool.setTenant(2, 1, 1000);   // 租户2权重为1，队列中最多1000个任务，超出时提交线程等待
+ pool.start(4);
+
+ TaskMeta meta;
+ meta.tenant = 2;
+ std::future<int> res = pool.submitTask(meta, sum, 1, 100);
+ pool.post(meta, []() { ... });
+ TenantStats st = pool.tenantStats(2);
+*/
+
+// 租户的统计信息
+struct TenantStats {
+    uint weight = 1;                 // 权重
+    size_t limit = TASK_MAX_THRESHHOLD; // 队列中任务数量的上限
+    size_t queued = 0;               // 当前排队的任务数量
+    size_t submitted = 0;            // 累计放入的任务数量
+    size_t dequeued = 0;             // 累计取出的任务数量
+    size_t rejected = 0;             // 累计因队列已满被拒绝的任务数量
+};
+
+// 任务队列策略：按租户分队列，用差额轮询（deficit round robin）在租户之间调度
+// 每个任务的代价记为1，租户每轮最多取出weight个任务，之后排到活跃租户的队尾；
+// 入队和出队都是O(1)，刷大量任务的租户只会让自己的队列变长，不会拖慢其他租户
+// 没有调用setTenant的租户权重为1、队列不限长
+class FairQueue {
+public:
+    FairQueue() : size_(0) {}
+
+    FairQueue(const FairQueue&) = delete;
+    FairQueue& operator=(const FairQueue&) = delete;
+
+    void push(PoolTask&& task, const TaskMeta& meta) {
+        Tenant& t = tenants_[meta.tenant];
+        t.tasks.emplace_back(std::move(task));
+        ++t.stats.submitted;
+        ++size_;
+        if (!t.active) {
+            // 租户由空变为不空，排到活跃租户的队尾，等下一轮再分配额度
+            t.active = true;
+            active_.push_back(&t);
+        }
+    }
+
+    PoolTask pop() {
+        Tenant* t = active_.front();
+        if (t->deficit == 0) {
+            t->deficit = t->stats.weight; // 轮到该租户，分配本轮额度
+        }
+        PoolTask task = std::move(t->tasks.front());
+        t->tasks.pop_front();
+        ++t->stats.dequeued;
+        --t->deficit;
+        --size_;
+
+        if (t->tasks.empty()) {
+            // 队列取空，退出活跃列表，剩余额度作废
+            t->active = false;
+            t->deficit = 0;
+            active_.pop_front();
+        } else if (t->deficit == 0) {
+            // 本轮额度用完，排到队尾
+            active_.pop_front();
+            active_.push_back(t);
+        }
+        return task;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 租户队列已满时不能放入
+    bool canPush(const TaskMeta& meta) const {
+        auto it = tenants_.find(meta.tenant);
+        return it == tenants_.end() || it->second.tasks.size() < it->second.stats.limit;
+    }
+
+    void onReject(const TaskMeta& meta) {
+        ++tenants_[meta.tenant].stats.rejected;
+    }
+
+    // 设置租户的权重和队列上限，权重最小为1
+    void setTenant(uint tenant, uint weight, size_t limit) {
+        Tenant& t = tenants_[tenant];
+        t.stats.weight = std::max(1u, weight);
+        t.stats.limit = limit;
+        if (t.deficit > t.stats.weight) {
+            t.deficit = t.stats.weight;
+        }
+    }
+
+    TenantStats stats(uint tenant) const {
+        auto it = tenants_.find(tenant);
+        if (it == tenants_.end()) {
+            return TenantStats();
+        }
+        TenantStats st = it->second.stats;
+        st.queued = it->second.tasks.size();
+        return st;
+    }
+
+private:
+    struct Tenant {
+        std::deque<PoolTask> tasks; // 租户的任务队列
+        uint deficit = 0;           // 本轮还能取出的任务数量
+        bool active = false;        // 是否在活跃租户列表中
+        TenantStats stats;
+    };
+
+    std::unordered_map<uint, Tenant> tenants_; // 租户编号到租户的映射，元素地址在rehash后不变
+    std::deque<Tenant*> active_; // 有任务排队的租户，按轮询顺序
+    size_t size_; // 所有租户的任务总数
+};
+
+#endif /* fairqueue_h */
@@ -0,0 +1,187 @@
+//
+//  FastLane.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef fastlane_h
+#define fastlane_h
+
+#include "RyanThreadPool.h"
+
+const size_t FAST_LANE_CAPACITY = 1024; // 通道默认容量，必须是2的幂
+const unsigned FAST_LANE_MAX_BACKOFF = 64; // 通道为空时，每次轮询之间最多执行的pause次数
+
+// 单生产者单消费者无锁环形队列
+// 生产者和消费者各自缓存对方的下标，只有看起来满/空时才去读对方的原子变量，减少cache line来回传递
+template<typename T>
+class SpscQueue {
+public:
+    // capacity会向上取整到2的幂
+    explicit SpscQueue(size_t capacity)
+        : head_(0)
+        , tailCache_(0)
+        , tail_(0)
+        , headCache_(0) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        buf_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 只能由生产者调用，队列满返回false
+    bool push(T&& item) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - headCache_ > mask_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (t - headCache_ > mask_) return false;
+        }
+        buf_[t & mask_] = std::move(item);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由消费者调用，队列空返回false
+    bool pop(T& item) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (h == tailCache_) return false;
+        }
+        item = std::move(buf_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+private:
+    std::vector<T> buf_;
+    size_t mask_;
+
+    // 消费者独占的cache line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_; // 下一个要取出的位置
+    size_t tailCache_; // 消费者缓存的tail_
+
+    // 生产者独占的cache line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_; // 下一个要放入的位置
+    size_t headCache_; // 生产者缓存的head_
+};
+
+/*
+example:
+ FastLane lane(1024, 3); // 独占线程绑定到3号CPU
+ lane.bindProducer();    // 当前线程是唯一的生产者，不调用时第一个post的线程成为生产者
+ lane.post([tick]() { onTick(tick); });
+*/
+
+// 低延迟通道：一个生产者线程通过SPSC队列把任务交给一个独占的、绑核的线程
+// 该线程一直忙轮询队列，不会挂起，提交到开始执行之间没有条件变量唤醒的开销
+// 通道为空时按指数退避执行pause，降低对同核超线程的干扰；代价是独占一个CPU
+// FastLane是独立于线程池的执行器，不从线程池中划出线程：线程池的任务队列是多生产者的，
+// 挂在它上面的忙轮询线程仍然要抢taskQueMtx_，拿不到SPSC交接的延迟。需要多个通道时创建多个FastLane
+class FastLane {
+public:
+    // cpu为-1时不绑核
+    explicit FastLane(size_t capacity = FAST_LANE_CAPACITY, int cpu = -1)
+        : que_(capacity)
+        , stop_(false)
+        , producer_(std::thread::id())
+        , running_(false) {
+        ThreadAttr attr;
+        attr.cpu = cpu;
+        thread_ = std::make_unique<Thread>(std::bind(&FastLane::threadFunc, this, std::placeholders::_1),
+                                           attr, "lane-" + std::to_string(nextPoolId()));
+        running_ = thread_->start();
+    }
+
+    // 执行完通道中剩余的任务后停止线程
+    ~FastLane() {
+        stop_.store(true, std::memory_order_release);
+        thread_->join();
+    }
+
+    FastLane(const FastLane&) = delete;
+    FastLane& operator=(const FastLane&) = delete;
+
+    // 独占线程是否创建成功，创建失败时post总是返回false
+    bool running() const {
+        return running_;
+    }
+
+    // 把调用线程注册为通道唯一的生产者，之后其他线程post会失败
+    // 生产者只能注册一次，已经注册了其他线程时返回false
+    bool bindProducer() {
+        if (!tryBind()) {
+            std::cerr << "fast lane producer already bound." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 提交任务，通道满、独占线程没有创建成功或者调用线程不是注册的生产者时返回false
+    // 还没有注册生产者时，第一个post的线程成为生产者，保证SPSC队列永远只有一个生产者
+    template<typename Func>
+    bool post(Func&& func) {
+        if (!running_) {
+            std::cerr << "fast lane thread is not running, post fail." << std::endl;
+            return false;
+        }
+        if (producer_.load(std::memory_order_acquire) != std::this_thread::get_id() && !tryBind()) {
+            std::cerr << "fast lane post from unregistered producer." << std::endl;
+            return false;
+        }
+        return que_.push(PoolTask(std::forward<Func>(func)));
+    }
+private:
+    // 还没有生产者时把调用线程注册为生产者，返回调用线程是否是生产者
+    bool tryBind() {
+        std::thread::id expected;
+        std::thread::id self = std::this_thread::get_id();
+        return producer_.compare_exchange_strong(expected, self, std::memory_order_acq_rel)
+            || expected == self;
+    }
+
+    void threadFunc(uint) {
+        PoolTask task;
+        unsigned backoff = 1;
+        for (;;) {
+            if (que_.pop(task)) {
+                runTask(task);
+                backoff = 1;
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire)) {
+                // 停止前再取一遍，保证stop之前提交的任务都执行完
+                while (que_.pop(task)) {
+                    runTask(task);
+                }
+                return;
+            }
+            for (unsigned i = 0; i < backoff; ++i) {
+                cpuRelax();
+            }
+            backoff = std::min(backoff * 2, FAST_LANE_MAX_BACKOFF);
+        }
+    }
+
+    void runTask(PoolTask& task) {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "task throw exception: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "task throw unknown exception" << std::endl;
+        }
+        task = nullptr;
+    }
+private:
+    SpscQueue<PoolTask> que_;
+    std::atomic_bool stop_;
+    std::atomic<std::thread::id> producer_; // 注册的生产者线程
+    std::unique_ptr<Thread> thread_; // 忙轮询的独占线程
+    bool running_; // 独占线程是否创建成功
+};
+
+#endif /* fastlane_h */
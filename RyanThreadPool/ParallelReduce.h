@@ -0,0 +1,396 @@
+//
+//  ParallelReduce.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef parallelreduce_h
+#define parallelreduce_h
+
+#include "RyanThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// 数值归约工具：数据按cache line对齐切块，分发给线程池各线程（核间并行），
+// 每个块内部用SIMD内核计算（向量通道并行），最后在调用线程合并各块结果。
+// SIMD指令集在编译期选择：AVX-512 > AVX > SSE2 > 标量，通过-march/-mavx2等编译选项控制。
+
+const size_t REDUCE_MIN_CHUNK  = 4096;    // 每个块的最少元素个数，太小的块不值得提交给线程池
+
+namespace simd {
+
+// 浮点向量指令的统一封装，内核按它来写，和具体指令集无关
+template<typename T>
+struct Vec;
+
+#if defined(__AVX512F__)
+template<>
+struct Vec<double> {
+    using V = __m512d;
+    static constexpr size_t width = 8;
+    static V zero() { return _mm512_setzero_pd(); }
+    static V load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, V v) { _mm512_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm512_min_pd(a, b); }
+    static V max(V a, V b) { return _mm512_max_pd(a, b); }
+};
+template<>
+struct Vec<float> {
+    using V = __m512;
+    static constexpr size_t width = 16;
+    static V zero() { return _mm512_setzero_ps(); }
+    static V load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, V v) { _mm512_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm512_min_ps(a, b); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+};
+#elif defined(__AVX__)
+template<>
+struct Vec<double> {
+    using V = __m256d;
+    static constexpr size_t width = 4;
+    static V zero() { return _mm256_setzero_pd(); }
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm256_min_pd(a, b); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+};
+template<>
+struct Vec<float> {
+    using V = __m256;
+    static constexpr size_t width = 8;
+    static V zero() { return _mm256_setzero_ps(); }
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+};
+#elif defined(__SSE2__)
+template<>
+struct Vec<double> {
+    using V = __m128d;
+    static constexpr size_t width = 2;
+    static V zero() { return _mm_setzero_pd(); }
+    static V load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm_min_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+};
+template<>
+struct Vec<float> {
+    using V = __m128;
+    static constexpr size_t width = 4;
+    static V zero() { return _mm_setzero_ps(); }
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+};
+#endif
+
+// 判断类型T是否有向量实现
+template<typename T, typename = void>
+struct HasVec : std::false_type {};
+template<typename T>
+struct HasVec<T, std::void_t<decltype(Vec<T>::width)>> : std::true_type {};
+
+// 求和的累加类型：整数扩宽到64位防止溢出，浮点保持原类型
+template<typename T>
+using SumType = std::conditional_t<std::is_floating_point<T>::value, T,
+                    std::conditional_t<std::is_signed<T>::value, long long, unsigned long long>>;
+
+// 水平归约：把向量各通道的值存出来再合并
+template<typename T, typename Op>
+T horizontal(typename Vec<T>::V v, T init, Op op) {
+    alignas(CACHE_LINE_SIZE) T lanes[Vec<T>::width];
+    Vec<T>::store(lanes, v);
+    for (size_t i = 0; i < Vec<T>::width; ++i) {
+        init = op(init, lanes[i]);
+    }
+    return init;
+}
+
+// 求和内核
+// 标量版本用4个独立累加器打破循环依赖，整数类型编译器可以直接自动向量化
+template<typename T>
+SumType<T> sum(const T* p, size_t n) {
+    size_t i = 0;
+    if constexpr (HasVec<T>::value) {
+        // 浮点加法不满足结合律，编译器不会自动向量化，这里显式使用向量指令
+        using VT = Vec<T>;
+        constexpr size_t W = VT::width;
+        auto a0 = VT::zero(), a1 = VT::zero(), a2 = VT::zero(), a3 = VT::zero();
+        for (; i + 4 * W <= n; i += 4 * W) {
+            a0 = VT::add(a0, VT::load(p + i));
+            a1 = VT::add(a1, VT::load(p + i + W));
+            a2 = VT::add(a2, VT::load(p + i + 2 * W));
+            a3 = VT::add(a3, VT::load(p + i + 3 * W));
+        }
+        for (; i + W <= n; i += W) {
+            a0 = VT::add(a0, VT::load(p + i));
+        }
+        T s = horizontal<T>(VT::add(VT::add(a0, a1), VT::add(a2, a3)), T(0), std::plus<T>());
+        for (; i < n; ++i) {
+            s += p[i];
+        }
+        return s;
+    } else {
+        SumType<T> s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += p[i];
+            s1 += p[i + 1];
+            s2 += p[i + 2];
+            s3 += p[i + 3];
+        }
+        for (; i < n; ++i) {
+            s0 += p[i];
+        }
+        return s0 + s1 + s2 + s3;
+    }
+}
+
+// 点积内核
+template<typename T>
+SumType<T> dot(const T* a, const T* b, size_t n) {
+    size_t i = 0;
+    if constexpr (HasVec<T>::value) {
+        using VT = Vec<T>;
+        constexpr size_t W = VT::width;
+        auto a0 = VT::zero(), a1 = VT::zero();
+        for (; i + 2 * W <= n; i += 2 * W) {
+            a0 = VT::add(a0, VT::mul(VT::load(a + i), VT::load(b + i)));
+            a1 = VT::add(a1, VT::mul(VT::load(a + i + W), VT::load(b + i + W)));
+        }
+        for (; i + W <= n; i += W) {
+            a0 = VT::add(a0, VT::mul(VT::load(a + i), VT::load(b + i)));
+        }
+        T s = horizontal<T>(VT::add(a0, a1), T(0), std::plus<T>());
+        for (; i < n; ++i) {
+            s += a[i] * b[i];
+        }
+        return s;
+    } else {
+        SumType<T> s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += SumType<T>(a[i]) * b[i];
+            s1 += SumType<T>(a[i + 1]) * b[i + 1];
+            s2 += SumType<T>(a[i + 2]) * b[i + 2];
+            s3 += SumType<T>(a[i + 3]) * b[i + 3];
+        }
+        for (; i < n; ++i) {
+            s0 += SumType<T>(a[i]) * b[i];
+        }
+        return s0 + s1 + s2 + s3;
+    }
+}
+
+// 最小值/最大值内核，n必须大于0
+template<typename T>
+std::pair<T, T> minMax(const T* p, size_t n) {
+    size_t i = 0;
+    T lo = p[0], hi = p[0];
+    if constexpr (HasVec<T>::value) {
+        using VT = Vec<T>;
+        constexpr size_t W = VT::width;
+        if (n >= W) {
+            auto vlo = VT::load(p), vhi = vlo;
+            for (i = W; i + W <= n; i += W) {
+                auto v = VT::load(p + i);
+                vlo = VT::min(vlo, v);
+                vhi = VT::max(vhi, v);
+            }
+            lo = horizontal<T>(vlo, lo, [](T x, T y) { return std::min(x, y); });
+            hi = horizontal<T>(vhi, hi, [](T x, T y) { return std::max(x, y); });
+        }
+    } else {
+        // 无分支写法，编译器可以生成pmin/pmax
+        T lo1 = lo, hi1 = hi;
+        for (; i + 2 <= n; i += 2) {
+            lo = p[i] < lo ? p[i] : lo;
+            hi = p[i] > hi ? p[i] : hi;
+            lo1 = p[i + 1] < lo1 ? p[i + 1] : lo1;
+            hi1 = p[i + 1] > hi1 ? p[i + 1] : hi1;
+        }
+        lo = std::min(lo, lo1);
+        hi = std::max(hi, hi1);
+    }
+    for (; i < n; ++i) {
+        lo = std::min(lo, p[i]);
+        hi = std::max(hi, p[i]);
+    }
+    return {lo, hi};
+}
+
+// 直方图内核：区间[lo, hi)等分成bins个桶，越界的值计入首尾桶
+// 使用4份子直方图交替计数，避免相邻元素落入同一个桶时的写后读依赖
+template<typename T>
+void histogram(const T* p, size_t n, T lo, T hi, size_t* out, size_t bins) {
+    std::vector<size_t> sub(4 * bins, 0);
+    const double scale = double(bins) / (double(hi) - double(lo));
+    auto bucket = [&](T x) -> size_t {
+        double pos = (double(x) - double(lo)) * scale;
+        if (pos < 0) return 0;
+        size_t b = size_t(pos);
+        return b < bins ? b : bins - 1;
+    };
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        ++sub[bucket(p[i])];
+        ++sub[bins + bucket(p[i + 1])];
+        ++sub[2 * bins + bucket(p[i + 2])];
+        ++sub[3 * bins + bucket(p[i + 3])];
+    }
+    for (; i < n; ++i) {
+        ++sub[bucket(p[i])];
+    }
+    for (size_t b = 0; b < bins; ++b) {
+        out[b] += sub[b] + sub[bins + b] + sub[2 * bins + b] + sub[3 * bins + b];
+    }
+}
+
+} // namespace simd
+
+// 把[0, n)切分成若干块，块边界对齐到cache line，避免相邻块在同一cache line上读写
+// 返回各块的起始下标，最后一个元素为n
+template<typename T>
+std::vector<size_t> splitChunks(const T* data, size_t n, size_t parts) {
+    std::vector<size_t> bounds{0};
+    const size_t lineElems = std::max<size_t>(1, CACHE_LINE_SIZE / sizeof(T));
+    parts = std::max<size_t>(1, std::min(parts, n / REDUCE_MIN_CHUNK));
+    if (parts > 1) {
+        // 第一个对齐到cache line的元素下标
+        size_t misalign = reinterpret_cast<uintptr_t>(data) % CACHE_LINE_SIZE;
+        size_t head = misalign == 0 ? 0 : (CACHE_LINE_SIZE - misalign) / sizeof(T);
+        size_t step = (n + parts - 1) / parts;
+        for (size_t i = 1; i < parts; ++i) {
+            size_t b = i * step;
+            b = b < head ? head : head + (b - head) / lineElems * lineElems;
+            if (b > bounds.back() && b < n) {
+                bounds.push_back(b);
+            }
+        }
+    }
+    bounds.push_back(n);
+    return bounds;
+}
+
+// 按块把内核提交给线程池，收集每块的结果
+// 提交失败（队列已满或线程池已关闭）的块在调用线程上直接计算，不会混入默认值
+// 等待结果时帮忙执行线程池队列中的任务，在线程池线程上调用（如单线程的线程池）也不会死锁
+template<typename R, typename Pool, typename T, typename Kernel>
+std::vector<R> parallelChunks(Pool& pool, const T* data, size_t n, size_t parts, Kernel kernel) {
+    std::vector<size_t> bounds = splitChunks(data, n, parts);
+    std::vector<std::future<R>> futures;
+    futures.reserve(bounds.size() - 1);
+    // 最后一块由调用线程自己计算，少一次任务投递
+    for (size_t i = 0; i + 2 < bounds.size(); ++i) {
+        auto task = std::make_shared<std::packaged_task<R()>>(std::bind(kernel, bounds[i], bounds[i + 1] - bounds[i]));
+        futures.emplace_back(task->get_future());
+        if (!pool.post([task]() { (*task)(); })) {
+            (*task)();
+        }
+    }
+    R last = kernel(bounds[bounds.size() - 2], n - bounds[bounds.size() - 2]);
+    std::vector<R> results;
+    results.reserve(bounds.size() - 1);
+    for (auto& f : futures) {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!pool.runPendingTask()) {
+                // 块已经在其他线程上执行，等待期间让出线程预算的名额
+                ThreadBudget::BlockingScope blocking;
+                f.wait();
+            }
+        }
+        results.emplace_back(f.get());
+    }
+    results.emplace_back(std::move(last));
+    return results;
+}
+
+// 并行求和
+template<typename Pool, typename T>
+simd::SumType<T> parallelSum(Pool& pool, const T* data, size_t n,
+                             size_t parts = std::thread::hardware_concurrency()) {
+    using R = simd::SumType<T>;
+    auto partial = parallelChunks<R>(pool, data, n, parts, [data](size_t off, size_t len) -> R {
+        return simd::sum(data + off, len);
+    });
+    R total = 0;
+    for (R v : partial) {
+        total += v;
+    }
+    return total;
+}
+
+// 并行点积
+template<typename Pool, typename T>
+simd::SumType<T> parallelDot(Pool& pool, const T* a, const T* b, size_t n,
+                             size_t parts = std::thread::hardware_concurrency()) {
+    using R = simd::SumType<T>;
+    auto partial = parallelChunks<R>(pool, a, n, parts, [a, b](size_t off, size_t len) -> R {
+        return simd::dot(a + off, b + off, len);
+    });
+    R total = 0;
+    for (R v : partial) {
+        total += v;
+    }
+    return total;
+}
+
+// 并行求最小值和最大值，n为0时返回{max(), lowest()}
+template<typename Pool, typename T>
+std::pair<T, T> parallelMinMax(Pool& pool, const T* data, size_t n,
+                               size_t parts = std::thread::hardware_concurrency()) {
+    std::pair<T, T> total{std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    if (n == 0) return total;
+    auto partial = parallelChunks<std::pair<T, T>>(pool, data, n, parts, [data](size_t off, size_t len) {
+        return simd::minMax(data + off, len);
+    });
+    for (auto& v : partial) {
+        total.first = std::min(total.first, v.first);
+        total.second = std::max(total.second, v.second);
+    }
+    return total;
+}
+
+// 并行直方图：区间[lo, hi)等分成bins个桶
+template<typename Pool, typename T>
+std::vector<size_t> parallelHistogram(Pool& pool, const T* data, size_t n, T lo, T hi, size_t bins,
+                                      size_t parts = std::thread::hardware_concurrency()) {
+    std::vector<size_t> total(bins, 0);
+    if (bins == 0 || n == 0 || !(lo < hi)) return total;
+    auto partial = parallelChunks<std::vector<size_t>>(pool, data, n, parts,
+        [data, lo, hi, bins](size_t off, size_t len) {
+            std::vector<size_t> h(bins, 0);
+            simd::histogram(data + off, len, lo, hi, h.data(), bins);
+            return h;
+        });
+    for (auto& h : partial) {
+        for (size_t b = 0; b < bins; ++b) {
+            total[b] += h[b];
+        }
+    }
+    return total;
+}
+
+#endif /* parallelreduce_h */
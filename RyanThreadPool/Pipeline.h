@@ -0,0 +1,258 @@
+//
+//  Pipeline.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef pipeline_h
+#define pipeline_h
+
+#include "RyanThreadPool.h"
+
+#include <any>
+#include <map>
+
+// 流水线阶段的执行方式
+enum class StageMode {
+    SERIAL_IN_ORDER, // 串行且按输入顺序执行，如写文件
+    PARALLEL,        // 可并行执行，如解析、压缩
+};
+
+/*
+example:
+ ThreadPool pool;
+ pool.start(4);
+
+ Pipeline pipe(pool, 16, 64); // 最多16个令牌在途，每个令牌装64条记录
+ pipe.addStage<std::string>(StageMode::PARALLEL, [](std::string line) { return parse(line); });
+ pipe.addStage<Record>(StageMode::SERIAL_IN_ORDER, [&](Record r) { write(r); });
+ pipe.run<std::string>([&](std::string& line) -> bool { return bool(std::getline(in, line)); });
+*/
+
+// 流水线类型
+// 数据被打包成令牌（一批记录）在各阶段之间移动，不做拷贝；所有阶段都在线程池的线程上执行，
+// 在途令牌数量有上限，以此限制内存占用
+// 某个阶段抛出异常、任务提交失败或者任务被线程池丢弃（ABORT关闭）后，不再读取新的输入，
+// 在途令牌跳过剩余的处理，run在令牌全部流出后抛出第一个异常
+template<typename Pool = ThreadPool>
+class BasicPipeline {
+public:
+    BasicPipeline(Pool& pool, size_t maxTokens, size_t batchSize = 1)
+        : pool_(pool)
+        , maxTokens_(maxTokens == 0 ? 1 : maxTokens)
+        , batchSize_(batchSize == 0 ? 1 : batchSize)
+        , inFlight_(0)
+        , failed_(false) {}
+
+    BasicPipeline(const BasicPipeline&) = delete;
+    BasicPipeline& operator=(const BasicPipeline&) = delete;
+
+    // 添加一个阶段，func接收In类型的记录（右值），返回值作为下一阶段的输入；返回void的阶段只能是最后一个阶段
+    template<typename In, typename Func>
+    BasicPipeline& addStage(StageMode mode, Func&& func) {
+        auto stage = std::make_unique<Stage>();
+        stage->mode = mode;
+        stage->func = [f = std::forward<Func>(func)](std::any& item) {
+            using RType = decltype(f(std::declval<In>()));
+            In* in = std::any_cast<In>(&item);
+            if constexpr (std::is_void<RType>::value) {
+                f(std::move(*in));
+                item.reset();
+            } else {
+                item = f(std::move(*in));
+            }
+        };
+        stages_.emplace_back(std::move(stage));
+        return *this;
+    }
+
+    // 运行流水线，直到source返回false且所有令牌都流出最后一个阶段
+    // source在调用线程上串行执行，每次填充一条记录，返回false表示输入结束
+    template<typename T, typename Source>
+    void run(Source&& source) {
+        for (auto& stage : stages_) {
+            stage->nextSeq = 0;
+            stage->busy = false;
+        }
+        error_ = nullptr;
+        failed_ = false;
+        size_t seq = 0;
+        bool more = true;
+        while (more && !failed_) {
+            auto token = std::make_shared<Token>();
+            token->items.reserve(batchSize_);
+            while (token->items.size() < batchSize_) {
+                T item;
+                if (!source(item)) {
+                    more = false;
+                    break;
+                }
+                token->items.emplace_back(std::move(item));
+            }
+            if (token->items.empty()) break;
+            token->seq = seq++;
+
+            // 在途令牌达到上限，等待有令牌流出流水线
+            {
+                std::unique_lock<std::mutex> ulock(mtx_);
+                tokenFree_.wait(ulock, [&]() -> bool {
+                    return inFlight_ < maxTokens_;
+                });
+                ++inFlight_;
+            }
+            dispatch(std::move(token), 0);
+        }
+
+        // 等待所有令牌流出
+        std::unique_lock<std::mutex> ulock(mtx_);
+        tokenFree_.wait(ulock, [&]() -> bool {
+            return inFlight_ == 0;
+        });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    // 令牌：一批记录和它在输入中的序号
+    struct Token {
+        size_t seq;
+        std::vector<std::any> items;
+        bool failed = false; // 处理失败，后续阶段不再处理，只按序号经过串行阶段
+    };
+
+    // 阶段
+    struct Stage {
+        StageMode mode;
+        std::function<void(std::any&)> func;
+
+        // 以下只用于SERIAL_IN_ORDER阶段
+        std::mutex mtx;
+        size_t nextSeq = 0;                           // 下一个应该处理的令牌序号
+        bool busy = false;                            // 是否有线程正在处理本阶段
+        std::map<size_t, std::shared_ptr<Token>> pending; // 乱序到达、暂存的令牌
+    };
+
+    // 提交给线程池的令牌，任务执行时取走令牌；任务没有执行就析构（提交失败或被ABORT/DEADLINE丢弃）时，
+    // 记录错误，令牌在析构的线程上跳过处理流出流水线，保证在途名额被释放、后面的令牌不会在串行阶段一直等它
+    struct Dispatched {
+        Dispatched(BasicPipeline* p, std::shared_ptr<Token> t, size_t idx)
+            : pipe(p), token(std::move(t)), stageIdx(idx), error("pipeline task dropped") {}
+        Dispatched(const Dispatched&) = delete;
+        Dispatched& operator=(const Dispatched&) = delete;
+
+        BasicPipeline* pipe;
+        std::shared_ptr<Token> token;
+        size_t stageIdx;
+        const char* error;
+
+        ~Dispatched() {
+            if (token) {
+                pipe->fail(std::make_exception_ptr(std::runtime_error(error)));
+                token->failed = true;
+                pipe->process(std::move(token), stageIdx);
+            }
+        }
+    };
+
+    // 把令牌作为任务提交给线程池，从第stageIdx个阶段开始处理
+    void dispatch(std::shared_ptr<Token> token, size_t stageIdx) {
+        auto task = std::make_shared<Dispatched>(this, std::move(token), stageIdx);
+        if (!pool_.post([task]() {
+            task->pipe->process(std::move(task->token), task->stageIdx);
+        })) {
+            task->error = "pipeline submit task fail";
+        }
+    }
+
+    // 在当前线程上把令牌依次推过各阶段
+    void process(std::shared_ptr<Token> token, size_t stageIdx) {
+        while (token && stageIdx < stages_.size()) {
+            Stage& stage = *stages_[stageIdx];
+            if (stage.mode == StageMode::PARALLEL) {
+                runStage(stage, *token);
+                ++stageIdx;
+                continue;
+            }
+
+            // 串行阶段：不是下一个应处理的令牌，或者有线程正在处理，就暂存起来由那个线程接着处理
+            {
+                std::lock_guard<std::mutex> guard(stage.mtx);
+                if (stage.busy || token->seq != stage.nextSeq) {
+                    size_t seq = token->seq;
+                    stage.pending.emplace(seq, std::move(token));
+                    return;
+                }
+                stage.busy = true;
+            }
+            for (;;) {
+                runStage(stage, *token);
+                std::shared_ptr<Token> next;
+                {
+                    std::lock_guard<std::mutex> guard(stage.mtx);
+                    ++stage.nextSeq;
+                    auto it = stage.pending.find(stage.nextSeq);
+                    if (it != stage.pending.end()) {
+                        next = std::move(it->second);
+                        stage.pending.erase(it);
+                    } else {
+                        stage.busy = false;
+                    }
+                }
+                if (!next) break;
+                // 处理完的令牌交给其他线程继续后面的阶段，本线程继续处理暂存的令牌
+                dispatch(std::move(token), stageIdx + 1);
+                token = std::move(next);
+            }
+            ++stageIdx;
+        }
+
+        // 令牌流出流水线，释放一个在途名额
+        token.reset();
+        std::lock_guard<std::mutex> guard(mtx_);
+        --inFlight_;
+        tokenFree_.notify_all();
+    }
+
+    // 执行一个阶段，异常不向外抛出，记录下来并把令牌标记为失败，保证令牌总能流出、串行阶段的busy总能清除
+    void runStage(Stage& stage, Token& token) {
+        if (token.failed || failed_) {
+            token.failed = true;
+            return;
+        }
+        try {
+            for (auto& item : token.items) {
+                stage.func(item);
+            }
+        } catch (...) {
+            token.failed = true;
+            fail(std::current_exception());
+        }
+    }
+
+    // 记录第一个错误
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        if (!error_) {
+            error_ = e;
+        }
+        failed_ = true;
+    }
+
+private:
+    Pool& pool_;
+    std::vector<std::unique_ptr<Stage>> stages_; // 各阶段，按添加顺序
+    size_t maxTokens_; // 在途令牌数量上限
+    size_t batchSize_; // 每个令牌装的记录条数
+
+    std::mutex mtx_;
+    size_t inFlight_; // 在途令牌数量
+    std::condition_variable tokenFree_; // 表示有令牌流出流水线
+    std::exception_ptr error_; // 第一个异常，由mtx_保护
+    std::atomic_bool failed_; // 是否已经出错，出错后不再读取输入、不再处理令牌
+};
+
+using Pipeline = BasicPipeline<>;
+
+#endif /* pipeline_h */
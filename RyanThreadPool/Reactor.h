@@ -0,0 +1,169 @@
+//
+//  Reactor.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef reactor_h
+#define reactor_h
+
+#ifdef __linux__
+
+#include "RyanThreadPool.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <system_error>
+
+const int REACTOR_MAX_EVENTS = 64; // 每次epoll_wait最多取出的事件数
+
+/*
+example:
+ Reactor reactor;
+ ThreadPool pool;
+ pool.setPoller(&reactor); // 空闲线程轮询reactor，不再需要单独的I/O线程
+ pool.start(4);
+
+ reactor.add(sockfd, EPOLLIN, [](uint32_t events) { ... }); // 在轮询的线程池线程上执行
+ std::future<uint32_t> ready = reactor.waitFor(pipefd, EPOLLIN); // 一次性等待，就绪时完成future
+*/
+
+// 基于epoll的I/O反应堆
+// 由线程池的空闲线程调用poll，就绪事件的处理函数直接在轮询线程上执行，省去I/O线程到线程池的一次切换
+// epoll只支持socket、管道等可轮询的描述符，普通文件总是就绪的，不需要注册
+class Reactor : public Poller {
+public:
+    // 事件处理函数，参数为就绪的epoll事件
+    using Handler = std::function<void(uint32_t)>;
+
+    Reactor()
+        : epfd_(epoll_create1(EPOLL_CLOEXEC))
+        , wakefd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (epfd_ < 0 || wakefd_ < 0) {
+            std::cerr << "reactor create fail: " << strerror(errno) << std::endl;
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wakefd_;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+    }
+
+    ~Reactor() {
+        if (wakefd_ >= 0) close(wakefd_);
+        if (epfd_ >= 0) close(epfd_);
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // 注册描述符，事件每次就绪都会调用handler
+    bool add(int fd, uint32_t events, Handler handler) {
+        return ctl(EPOLL_CTL_ADD, fd, events, std::make_shared<Entry>(Entry{std::move(handler), false}));
+    }
+
+    // 修改描述符关注的事件
+    bool modify(int fd, uint32_t events) {
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> guard(mtx_);
+            auto it = handlers_.find(fd);
+            if (it == handlers_.end()) return false;
+            entry = it->second;
+        }
+        return ctl(EPOLL_CTL_MOD, fd, events, entry);
+    }
+
+    // 注销描述符，需要在close(fd)之前调用
+    void remove(int fd) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        if (handlers_.erase(fd) > 0) {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+    // 一次性等待描述符就绪，就绪后自动注销并完成future
+    std::future<uint32_t> waitFor(int fd, uint32_t events) {
+        auto promise = std::make_shared<std::promise<uint32_t>>();
+        std::future<uint32_t> result = promise->get_future();
+        auto entry = std::make_shared<Entry>(Entry{[promise](uint32_t ev) {
+            promise->set_value(ev);
+        }, true});
+        if (!ctl(EPOLL_CTL_ADD, fd, events | EPOLLONESHOT, entry)) {
+            promise->set_exception(std::make_exception_ptr(
+                std::system_error(errno, std::generic_category(), "reactor waitFor fail")));
+        }
+        return result;
+    }
+
+    // 等待并处理就绪事件
+    void poll(int timeoutMs) override {
+        epoll_event events[REACTOR_MAX_EVENTS];
+        int n = epoll_wait(epfd_, events, REACTOR_MAX_EVENTS, timeoutMs);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakefd_) {
+                uint64_t cnt;
+                while (read(wakefd_, &cnt, sizeof(cnt)) > 0) {}
+                continue;
+            }
+
+            // 拷贝一份处理函数再执行，执行期间允许handler调用add/remove
+            std::shared_ptr<Entry> entry;
+            {
+                std::lock_guard<std::mutex> guard(mtx_);
+                auto it = handlers_.find(fd);
+                if (it == handlers_.end()) continue;
+                entry = it->second;
+                if (entry->oneShot) {
+                    handlers_.erase(it);
+                    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+                }
+            }
+            entry->handler(events[i].events);
+        }
+    }
+
+    // 唤醒阻塞在epoll_wait中的线程
+    void wakeup() override {
+        uint64_t one = 1;
+        ssize_t ret = write(wakefd_, &one, sizeof(one));
+        (void)ret;
+    }
+
+private:
+    struct Entry {
+        Handler handler;
+        bool oneShot; // 一次性注册，就绪后自动注销
+    };
+
+    bool ctl(int op, int fd, uint32_t events, std::shared_ptr<Entry> entry) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd_, op, fd, &ev) < 0) {
+            int err = errno;
+            std::cerr << "reactor epoll_ctl fail, fd: " << fd << " " << strerror(err) << std::endl;
+            errno = err;
+            return false;
+        }
+        handlers_[fd] = std::move(entry);
+        return true;
+    }
+
+private:
+    int epfd_; // epoll描述符
+    int wakefd_; // 用于唤醒轮询线程的eventfd
+
+    std::mutex mtx_; // 保护handlers_
+    std::unordered_map<int, std::shared_ptr<Entry>> handlers_; // 描述符到处理函数的映射
+};
+
+#endif /* __linux__ */
+
+#endif /* reactor_h */
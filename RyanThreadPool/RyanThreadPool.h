@@ -11,6 +11,7 @@
 #include <iostream>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <atomic>
 #include <mutex>
@@ -18,12 +19,32 @@
 #include <functional>
 #include <thread>
 #include <future>
+#include <system_error>
+#include <algorithm>
 #include <chrono>
 #include <unordered_map>
+#include <typeindex>
+#include <optional>
+#include <string>
+#include <cstring>
+#include <climits>
+#include <pthread.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 const int TASK_MAX_THRESHHOLD = INT32_MAX;
 const int THREAD_MAX_THRESHHOLD = 10;
 const int THREAD_MAX_IDLE_TIME  = 60; // 秒
+const int TASK_MAX_BATCH = 32; // 线程一次从任务队列取出的任务数量上限
+const int TASK_BATCH_TARGET_NS = 50000; // 一批任务的目标执行时间（纳秒）
+const int THREAD_SPIN_ROUNDS = 2000; // 自旋等待策略下，线程挂起前自旋检查任务队列的次数
+const int KEYED_TASK_SHARDS = 16; // 按键去重的在途任务表的分片数量
+const size_t CACHE_LINE_SIZE = 64; // cache line大小（字节），用于对齐避免伪共享
 
 // 线程池支持的模式
 enum class PoolMode {
@@ -31,33 +52,572 @@ enum class PoolMode {
     MODE_CACHED, // 动态增长模式
 };
 
+// 线程池关闭方式
+enum class ShutdownMode {
+    DRAIN,    // 执行完队列中的所有任务再关闭
+    ABORT,    // 丢弃队列中未执行的任务，对应的future抛出broken_promise异常
+    DEADLINE, // 在期限内尽量执行队列中的任务，超时后丢弃剩余任务
+};
+
+// 任务队列已满或字节预算不足时的处理方式
+enum class AdmissionMode {
+    BLOCK,  // 提交线程最多等待1s，仍然放不进去则提交失败
+    REJECT, // 立即提交失败
+};
+
+// 空闲线程轮询的事件源接口（如I/O反应堆）
+// 线程池中同一时刻最多有一个空闲线程在poll中等待事件，事件处理函数直接在该线程上执行
+class Poller {
+public:
+    virtual ~Poller() = default;
+    
+    // 等待并处理事件，最多阻塞timeoutMs毫秒，-1表示一直等待直到wakeup
+    virtual void poll(int timeoutMs) = 0;
+    
+    // 唤醒阻塞在poll中的线程
+    virtual void wakeup() = 0;
+};
+
+// 线程池中的任务类型
+using PoolTask = std::function<void()>;
+
+// 任务的附加信息，随任务一起交给任务队列策略，不关心的策略直接忽略
+struct TaskMeta {
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    uint tenant = 0; // 任务所属租户
+    size_t bytes = 0; // 任务占用内存的估计值（如捕获的数据），从提交到执行完一直计入字节预算
+    TimePoint deadline = TimePoint::max(); // 任务期限，开始执行时已经过期就跳过，默认没有期限
+
+    bool hasDeadline() const { return deadline != TimePoint::max(); }
+    bool expired() const { return hasDeadline() && std::chrono::steady_clock::now() > deadline; }
+};
+
+// 任务过期被跳过时，future或完成回调得到的异常
+inline std::system_error deadlineExpired() {
+    return std::system_error(std::make_error_code(std::errc::timed_out), "task deadline expired");
+}
+
+// 自旋等待时让出流水线资源
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// 字节预算，可以由多个线程池共享，限制整个进程在途任务占用的内存
+// 在途字节数为0时总是允许申请，超过上限的单个任务不会永远放不进去
+class ByteBudget {
+public:
+    explicit ByteBudget(size_t limit) : limit_(limit), inFlight_(0) {}
+
+    ByteBudget(const ByteBudget&) = delete;
+    ByteBudget& operator=(const ByteBudget&) = delete;
+
+    // 申请bytes字节，预算不足时最多等待timeout，返回是否申请成功
+    bool acquire(size_t bytes, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> ulock(mtx_);
+        auto pred = [&]() -> bool {
+            return inFlight_ == 0 || inFlight_ + bytes <= limit_;
+        };
+        if (!released_.wait_for(ulock, timeout, pred)) {
+            return false;
+        }
+        inFlight_ += bytes;
+        return true;
+    }
+
+    // 归还bytes字节
+    void release(size_t bytes) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        inFlight_ -= bytes;
+        released_.notify_all();
+    }
+
+    size_t limit() const { return limit_; }
+    size_t inFlight() const { return inFlight_; }
+private:
+    const size_t limit_; // 字节上限
+    std::atomic<size_t> inFlight_; // 在途字节数，由mtx_保护写入
+    std::mutex mtx_;
+    std::condition_variable released_; // 表示有字节被归还
+};
+
+// 进程级线程预算，由多个线程池共享，限制同时在执行任务的线程总数，避免多个线程池叠加后线程数远超CPU核数
+// 线程池的线程仍然各自创建，但执行任务前要先拿到一个名额，空闲或者名额被收回时让出；
+// 每个线程池有保证的最小名额，自己用不完的名额可以借给其他线程池，需要时借出的名额在对方执行完当前这批任务后收回
+// 注意：名额按正在执行的任务计算，任务阻塞（等待future、锁、sleep、I/O）时仍然占着名额。
+// 任务阻塞等待同一预算中其他任务的结果时，要在BlockingScope中等待，否则名额用完后会死锁；
+// TaskGroup::wait已经这样做了，直接调用future::get不会自动让出
+class ThreadBudget {
+public:
+    // 注册到预算中的线程池
+    struct Slot {
+        std::string name; // 线程池名称
+        uint minThreads;  // 保证的最小名额
+        uint active;      // 正在使用的名额
+        uint waiting;     // 等待名额的线程数量
+    };
+
+    // 线程池线程持有的名额
+    struct Holder {
+        ThreadBudget* budget;
+        Slot* slot;
+        bool held; // 是否持有名额
+
+        void acquire() {
+            if (!held) {
+                budget->acquire(slot);
+                held = true;
+            }
+        }
+        void release() {
+            if (held) {
+                budget->release(slot);
+                held = false;
+            }
+        }
+    };
+
+    // 任务中阻塞等待时让出当前线程的名额，离开作用域时重新获取
+    // 不是加入了预算的线程池线程，或者当前没有持有名额时什么也不做
+    class BlockingScope {
+    public:
+        BlockingScope()
+            : holder_(current())
+            , released_(holder_ != nullptr && holder_->held) {
+            if (released_) {
+                holder_->release();
+            }
+        }
+        ~BlockingScope() {
+            if (released_) {
+                holder_->acquire();
+            }
+        }
+        BlockingScope(const BlockingScope&) = delete;
+        BlockingScope& operator=(const BlockingScope&) = delete;
+    private:
+        Holder* holder_;
+        bool released_;
+    };
+
+    // 当前线程持有的名额，不是加入了预算的线程池线程时为nullptr
+    static Holder*& current() {
+        static thread_local Holder* holder = nullptr;
+        return holder;
+    }
+
+    // 预算的使用情况
+    struct Usage {
+        std::string name;
+        uint minThreads;
+        uint active;
+    };
+
+    explicit ThreadBudget(uint total = std::thread::hardware_concurrency())
+        : total_(std::max(1u, total))
+        , reserved_(0)
+        , active_(0)
+        , waiting_(0) {}
+
+    ThreadBudget(const ThreadBudget&) = delete;
+    ThreadBudget& operator=(const ThreadBudget&) = delete;
+
+    // 进程级的默认预算，名额为CPU核数
+    static ThreadBudget& instance() {
+        static ThreadBudget budget;
+        return budget;
+    }
+
+    // 注册线程池，所有线程池保证的名额之和不能超过总名额，超出时只保证剩余的部分
+    Slot* attach(const std::string& name, uint minThreads) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        if (reserved_ + minThreads > total_) {
+            std::cerr << "thread budget over reserved, pool " << name << " min threads: "
+                << minThreads << " -> " << total_ - reserved_ << std::endl;
+            minThreads = total_ - reserved_;
+        }
+        reserved_ += minThreads;
+        slots_.emplace_back(std::make_unique<Slot>(Slot{name, minThreads, 0, 0}));
+        return slots_.back().get();
+    }
+
+    // 注销线程池，调用时线程池的线程必须已经全部退出
+    void detach(Slot* slot) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        for (auto it = slots_.begin(); it != slots_.end(); ++it) {
+            if (it->get() == slot) {
+                reserved_ -= slot->minThreads;
+                slots_.erase(it);
+                break;
+            }
+        }
+        released_.notify_all();
+    }
+
+    // 获取一个名额，没有可用名额时等待
+    void acquire(Slot* slot) {
+        std::unique_lock<std::mutex> ulock(mtx_);
+        if (!canGrant(*slot)) {
+            ++slot->waiting;
+            ++waiting_;
+            released_.wait(ulock, [&]() -> bool {
+                return canGrant(*slot);
+            });
+            --slot->waiting;
+            --waiting_;
+        }
+        ++slot->active;
+        ++active_;
+    }
+
+    // 归还一个名额
+    void release(Slot* slot) {
+        std::lock_guard<std::mutex> guard(mtx_);
+        --slot->active;
+        --active_;
+        if (waiting_ > 0) {
+            released_.notify_all();
+        }
+    }
+
+    // 是否有线程在等待名额，执行完一批任务的线程据此决定是否让出名额
+    bool contended() const {
+        return waiting_.load(std::memory_order_relaxed) > 0;
+    }
+
+    uint total() const { return total_; }
+
+    std::vector<Usage> usage() const {
+        std::lock_guard<std::mutex> guard(mtx_);
+        std::vector<Usage> res;
+        for (auto& slot : slots_) {
+            res.push_back(Usage{slot->name, slot->minThreads, slot->active});
+        }
+        return res;
+    }
+
+private:
+    // 名额没有用完时：没达到保证数量的线程池总能拿到；
+    // 超出保证数量的只能借用，有线程池在等待自己保证的名额时不再借出
+    bool canGrant(const Slot& slot) const {
+        if (active_ >= total_) return false;
+        if (slot.active < slot.minThreads) return true;
+        for (auto& other : slots_) {
+            if (other->waiting > 0 && other->active < other->minThreads) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const uint total_; // 总名额
+    uint reserved_;    // 各线程池保证的名额之和
+    uint active_;      // 正在使用的名额
+    std::atomic_uint waiting_; // 等待名额的线程数量，由mtx_保护写入
+    std::vector<std::unique_ptr<Slot>> slots_;
+    mutable std::mutex mtx_;
+    std::condition_variable released_; // 表示有名额被归还
+};
+
+////////////* 线程池策略 *////////////
+// 线程池按以下四类策略在编译期组合，策略没有选用的功能（伸缩计数、自旋、统计）在编译期去掉：
+// 任务队列策略、等待策略、线程数量伸缩策略、统计策略
+// 线程预算、事件源、延迟创建和resize是运行时设置，没有启用时线程取任务时只多几次可预测的分支判断
+
+// 任务队列策略需要提供：
+// push(task, meta)、pop()、size()、empty()，
+// canPush(meta)：队列级别的上限之外，策略自己是否还能接收这个任务，不能接收时提交线程等待，
+// onReject(meta)：任务等待超时被拒绝时调用
+
+// 任务队列策略：先进先出队列，底层为std::queue
+class FifoQueue {
+public:
+    void push(PoolTask&& task, const TaskMeta&) { que_.emplace(std::move(task)); }
+    PoolTask pop() {
+        PoolTask task = std::move(que_.front());
+        que_.pop();
+        return task;
+    }
+    size_t size() const { return que_.size(); }
+    bool empty() const { return que_.empty(); }
+    bool canPush(const TaskMeta&) const { return true; }
+    void onReject(const TaskMeta&) {}
+private:
+    std::queue<PoolTask> que_;
+};
+
+// 任务队列策略：环形缓冲区，容量按2的幂增长，稳定运行后入队出队不再分配内存
+class RingQueue {
+public:
+    RingQueue() : buf_(64), head_(0), tail_(0) {}
+    void push(PoolTask&& task, const TaskMeta&) {
+        if (tail_ - head_ == buf_.size()) {
+            grow();
+        }
+        buf_[tail_++ & (buf_.size() - 1)] = std::move(task);
+    }
+    PoolTask pop() {
+        return std::move(buf_[head_++ & (buf_.size() - 1)]);
+    }
+    size_t size() const { return tail_ - head_; }
+    bool empty() const { return tail_ == head_; }
+    bool canPush(const TaskMeta&) const { return true; }
+    void onReject(const TaskMeta&) {}
+private:
+    void grow() {
+        std::vector<PoolTask> buf(buf_.size() * 2);
+        for (size_t i = head_; i != tail_; ++i) {
+            buf[i - head_] = std::move(buf_[i & (buf_.size() - 1)]);
+        }
+        tail_ -= head_;
+        head_ = 0;
+        buf_.swap(buf);
+    }
+    std::vector<PoolTask> buf_;
+    size_t head_; // 队头下标（单调递增，取模后访问）
+    size_t tail_; // 队尾下标
+};
+
+// 任务队列策略：按期限从早到晚出队（EDF），期限相同或没有期限的任务按提交顺序出队
+// 没有期限的任务排在所有有期限的任务之后；入队出队为O(log n)
+class DeadlineQueue {
+public:
+    DeadlineQueue() : seq_(0) {}
+    void push(PoolTask&& task, const TaskMeta& meta) {
+        heap_.push_back(Entry{meta.deadline, seq_++, std::move(task)});
+        std::push_heap(heap_.begin(), heap_.end(), later);
+    }
+    PoolTask pop() {
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        PoolTask task = std::move(heap_.back().task);
+        heap_.pop_back();
+        return task;
+    }
+    size_t size() const { return heap_.size(); }
+    bool empty() const { return heap_.empty(); }
+    bool canPush(const TaskMeta&) const { return true; }
+    void onReject(const TaskMeta&) {}
+private:
+    struct Entry {
+        TaskMeta::TimePoint deadline;
+        size_t seq; // 入队序号，期限相同时先入队的先出队
+        PoolTask task;
+    };
+    // 小顶堆的比较函数：a比b晚出队
+    static bool later(const Entry& a, const Entry& b) {
+        if (a.deadline != b.deadline) return a.deadline > b.deadline;
+        return a.seq > b.seq;
+    }
+    std::vector<Entry> heap_;
+    size_t seq_;
+};
+
+// 等待策略：任务队列为空时直接在条件变量上挂起
+struct ParkWait {
+    static constexpr bool spins = false;
+};
+
+// 等待策略：挂起前先自旋一段时间，适合任务间隔很短、对唤醒延迟敏感的场景
+struct SpinParkWait {
+    static constexpr bool spins = true;
+    
+    // 自旋等待ready()为真，超过THREAD_SPIN_ROUNDS次返回false
+    template<typename Pred>
+    static bool spin(Pred ready) {
+        for (int i = 0; i < THREAD_SPIN_ROUNDS; ++i) {
+            if (ready()) return true;
+            cpuRelax();
+        }
+        return false;
+    }
+};
+
+// 伸缩策略：线程数量固定，不维护空闲线程数和任务数等计数
+struct FixedScaling {
+    static constexpr bool canGrow = false;
+    bool cached() const { return false; }
+};
+
+// 伸缩策略：总是cached模式，按需创建线程，空闲超时回收
+struct CachedScaling {
+    static constexpr bool canGrow = true;
+    bool cached() const { return true; }
+};
+
+// 伸缩策略：运行前通过setMode在fixed和cached模式之间切换
+struct ModeScaling {
+    static constexpr bool canGrow = true;
+    bool cached() const { return mode == PoolMode::MODE_CACHED; }
+    void setMode(PoolMode m) { mode = m; }
+    PoolMode mode = PoolMode::MODE_FIXED;
+};
+
+// 统计策略：不统计
+struct NoStats {
+    void onSubmit() {}
+    void onBatch(size_t) {}
+    void onSteal(size_t) {}
+    void onExecute() {}
+    void onExpire() {}
+    void onDedup() {}
+};
+
+// 统计策略：用原子计数器统计提交、执行、批量取任务、窃取、过期和去重的次数
+class AtomicStats {
+public:
+    void onSubmit() { submitted_.fetch_add(1, std::memory_order_relaxed); }
+    void onBatch(size_t n) {
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        batchedTasks_.fetch_add(n, std::memory_order_relaxed);
+    }
+    void onSteal(size_t n) { stolen_.fetch_add(n, std::memory_order_relaxed); }
+    void onExecute() { executed_.fetch_add(1, std::memory_order_relaxed); }
+    void onExpire() { expired_.fetch_add(1, std::memory_order_relaxed); }
+    void onDedup() { deduped_.fetch_add(1, std::memory_order_relaxed); }
+    
+    size_t submitted() const { return submitted_.load(std::memory_order_relaxed); }
+    size_t executed() const { return executed_.load(std::memory_order_relaxed); }
+    size_t batches() const { return batches_.load(std::memory_order_relaxed); }
+    size_t batchedTasks() const { return batchedTasks_.load(std::memory_order_relaxed); }
+    size_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+    size_t expired() const { return expired_.load(std::memory_order_relaxed); }
+    size_t deduped() const { return deduped_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<size_t> submitted_{0}; // 提交的任务数
+    std::atomic<size_t> executed_{0}; // 执行完的任务数
+    std::atomic<size_t> batches_{0}; // 从任务队列批量取任务的次数
+    std::atomic<size_t> batchedTasks_{0}; // 从任务队列取出的任务总数
+    std::atomic<size_t> stolen_{0}; // 从其他线程本地缓冲窃取的任务数
+    std::atomic<size_t> expired_{0}; // 开始执行时已经过期、被跳过的任务数
+    std::atomic<size_t> deduped_{0}; // 按键去重、没有重复提交的任务数
+};
+
+// 线程属性
+struct ThreadAttr {
+    size_t stackSize = 0; // 线程栈大小（字节），0表示使用系统默认值（Linux通常为8MB）
+    int niceValue = 0; // 线程的nice值，0表示不修改（仅Linux）
+    int schedPolicy = -1; // 调度策略，如SCHED_FIFO、SCHED_RR、SCHED_BATCH，-1表示不修改
+    int schedPriority = 0; // 调度优先级，SCHED_FIFO/SCHED_RR下有效
+    bool lockStack = false; // 是否用mlock锁定线程栈，避免被换出（仅Linux）
+    int cpu = -1; // 把线程绑定到指定的CPU上，-1表示不绑定（仅Linux）；按线程设置，主要给FastLane的独占线程用
+};
+
 // 线程类型
 class Thread {
 public:
     // 线程函数对象类型
     using ThreadFunc = std::function<void(uint)>;
     
-    // 线程构造函数
-    Thread(ThreadFunc func)
+    // 线程构造函数，name为线程名，Linux下最多15个字符
+    Thread(ThreadFunc func, const ThreadAttr& attr = ThreadAttr(), std::string name = std::string())
         : func_(func)
+        , attr_(attr)
+        , name_(std::move(name))
+        , started_(false)
         , threadId_(generateId_++) {}
 
     // 线程析构函数
-    ~Thread() = default;
+    ~Thread() {
+        join();
+    }
 
     // 启动线程
-    void start() {
-        // 创建一个线程来执行一个线程函数
-        std::thread t(func_, threadId_); // 出了作用域，线程对象t被销毁，线程函数func_一直在，所以要detach
-        t.detach();
+    // 直接使用pthread创建线程，才能设置栈大小；线程对象由Thread持有，线程池回收时join
+    bool start() {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (attr_.stackSize > 0) {
+            pthread_attr_setstacksize(&attr, std::max<size_t>(attr_.stackSize, PTHREAD_STACK_MIN));
+        }
+        int err = pthread_create(&thread_, &attr, &Thread::entry, this);
+        pthread_attr_destroy(&attr);
+        if (err != 0) {
+            std::cerr << "thread create fail: " << strerror(err) << std::endl;
+            return false;
+        }
+        started_ = true;
+        return true;
+    }
+    
+    // 等待线程函数返回，不能在线程自己身上调用
+    void join() {
+        if (started_) {
+            pthread_join(thread_, nullptr);
+            started_ = false;
+        }
     }
     
     // 获取线程id
     uint getId() const {
         return threadId_;
     }
+private:
+    // 线程入口：先在新线程上应用线程属性，再执行线程函数
+    static void* entry(void* arg) {
+        Thread* self = static_cast<Thread*>(arg);
+        self->applyAttr();
+        self->func_(self->threadId_);
+        return nullptr;
+    }
+    
+    // 属性设置失败只打印错误，线程照常运行
+    void applyAttr() {
+        if (!name_.empty()) {
+#if defined(__linux__)
+            pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+            pthread_setname_np(name_.c_str());
+#endif
+        }
+        if (attr_.schedPolicy >= 0) {
+            sched_param param{};
+            param.sched_priority = attr_.schedPriority;
+            int err = pthread_setschedparam(pthread_self(), attr_.schedPolicy, &param);
+            if (err != 0) {
+                std::cerr << "thread set sched policy fail: " << strerror(err) << std::endl;
+            }
+        }
+#ifdef __linux__
+        if (attr_.cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(attr_.cpu, &set);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (err != 0) {
+                std::cerr << "thread set cpu affinity fail: " << strerror(err) << std::endl;
+            }
+        }
+        // Linux下nice值是线程级别的
+        if (attr_.niceValue != 0
+            && setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), attr_.niceValue) != 0) {
+            std::cerr << "thread set nice fail: " << strerror(errno) << std::endl;
+        }
+        if (attr_.lockStack) {
+            pthread_attr_t attr;
+            void* addr = nullptr;
+            size_t size = 0;
+            if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+                pthread_attr_getstack(&attr, &addr, &size);
+                pthread_attr_destroy(&attr);
+            }
+            if (addr == nullptr || mlock(addr, size) != 0) {
+                std::cerr << "thread lock stack fail: " << strerror(errno) << std::endl;
+            }
+        }
+#endif
+    }
+    
 private:
     ThreadFunc func_;
+    ThreadAttr attr_;
+    std::string name_;
+    pthread_t thread_;
+    bool started_; // 线程是否已创建且还没有join
     
     static uint generateId_;
     uint threadId_; //  线程id
@@ -65,44 +625,173 @@ private:
 
 uint Thread::generateId_ = 0;
 
+// 按键去重的在途任务表：键到任务结果（shared_future）的映射，按键的哈希值分片加锁
+// 任务执行完就从表中删除，之后相同键的提交会重新执行
+class InFlightTable {
+public:
+    struct Entry {
+        std::type_index type;         // 任务返回值类型
+        std::shared_ptr<void> result; // 指向std::shared_future<返回值类型>
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& shard(const std::string& key) {
+        return shards_[std::hash<std::string>()(key) % KEYED_TASK_SHARDS];
+    }
+
+    // 删除key对应的表项，只删除result指向的那一个，表项已经被替换时不删除
+    void erase(const std::string& key, const void* result) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> guard(s.mtx);
+        auto it = s.entries.find(key);
+        if (it != s.entries.end() && it->second.result.get() == result) {
+            s.entries.erase(it);
+        }
+    }
+
+    // 在途任务数量
+    size_t size() {
+        size_t n = 0;
+        for (auto& s : shards_) {
+            std::lock_guard<std::mutex> guard(s.mtx);
+            n += s.entries.size();
+        }
+        return n;
+    }
+
+private:
+    Shard shards_[KEYED_TASK_SHARDS];
+};
+
+// 生成线程池编号，用于线程命名
+inline uint nextPoolId() {
+    static std::atomic_uint poolId(0);
+    return poolId++;
+}
+
 // 线程池类型
-class ThreadPool
+// QueuePolicy: FifoQueue / RingQueue / DeadlineQueue / FairQueue（FairQueue.h）
+// WaitPolicy: ParkWait / SpinParkWait
+// ScalingPolicy: ModeScaling / FixedScaling / CachedScaling
+// StatsPolicy: NoStats / AtomicStats
+template<typename QueuePolicy = FifoQueue,
+         typename WaitPolicy = ParkWait,
+         typename ScalingPolicy = ModeScaling,
+         typename StatsPolicy = NoStats>
+class BasicThreadPool
 {
 public:
     // 初始化线程池
-    ThreadPool()
+    BasicThreadPool()
         : initThreadNums_(0)
         , threadNumsMaxThreshold_(THREAD_MAX_THRESHHOLD)
         , idleThreadNums_(0)
         , threadNums_(0)
         , taskNums_(0)
         , taskNumsMaxThreshhold_(TASK_MAX_THRESHHOLD)
-        , poolMode_(PoolMode::MODE_FIXED)
-        , isRuning_(false) {}
+        , queued_(0)
+        , blockedProducers_(0)
+        , isRuning_(false)
+        , isStopped_(false)
+        , retireThreadNums_(0)
+        , poolId_(nextPoolId())
+        , workerSeq_(0)
+        , lazyStart_(false)
+        , admission_(AdmissionMode::BLOCK)
+        , byteBudget_(SIZE_MAX)
+        , bytesInFlight_(0)
+        , globalBudget_(nullptr)
+        , poller_(nullptr)
+        , polling_(false)
+        , parkedThreadNums_(0)
+        , budget_(nullptr)
+        , budgetSlot_(nullptr) {}
     
     // 销毁线程池
-    ~ThreadPool() {
+    ~BasicThreadPool() {
+        shutdown(ShutdownMode::DRAIN);
+        if (budget_ != nullptr) {
+            budget_->detach(budgetSlot_);
+        }
+    }
+    
+    // 关闭线程池：不再接收新任务，按mode处理队列中剩余的任务，等待并join所有线程
+    // DEADLINE模式下timeout为执行剩余任务的期限。关闭后可以再次调用start启动
+    void shutdown(ShutdownMode mode = ShutdownMode::DRAIN,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+        std::unique_lock<std::mutex> ulock(taskQueMtx_);
+        isStopped_ = true;
+        if (mode == ShutdownMode::ABORT) {
+            abortTasks(ulock);
+        }
         isRuning_ = false;
-    //    notEmpty_.notify_all();
         
         // 等待线程池中所有线程返回（阻塞 and 运行）
-        std::unique_lock<std::mutex> ulock(taskQueMtx_);
         notEmpty_.notify_all(); // 防止死锁
-        exitCond_.wait(ulock, [&]() -> bool {
+        notFull_.notify_all();
+        if (polling_) {
+            poller_->wakeup();
+        }
+        auto allExit = [&]() -> bool {
             return threads_.size() == 0;
-        });
+        };
+        if (mode == ShutdownMode::DEADLINE && !exitCond_.wait_for(ulock, timeout, allExit)) {
+            // 期限已到，丢弃还没执行的任务
+            abortTasks(ulock);
+        }
+        exitCond_.wait(ulock, allExit);
+        ulock.unlock();
+        
+        reapThreads();
+    }
+    
+    // 运行时调整线程数量：增加时立即创建新线程，减少时多余的线程执行完手头的任务后退出
+    // 线程数量至少为1，否则之后提交的任务没有线程执行
+    void resize(int threadNums) {
+        if (threadNums < 1) {
+            std::cerr << "resize thread nums must be at least 1: " << threadNums << std::endl;
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> ulock(taskQueMtx_);
+            if (!isRuning_) return;
+            
+            // 还在退出途中的线程先算进来
+            int cur = int(threads_.size()) - int(retireThreadNums_);
+            if (threadNums > cur) {
+                // 抵消还没退出的线程，剩下的差额创建新线程
+                int cancel = std::min(threadNums - cur, int(retireThreadNums_));
+                retireThreadNums_ -= cancel;
+                for (int i = cur + cancel; i < threadNums; ++i) {
+                    spawnThread();
+                }
+            } else if (threadNums < cur) {
+                retireThreadNums_ += cur - threadNums;
+                notEmpty_.notify_all();
+                if (polling_) {
+                    poller_->wakeup();
+                }
+            }
+            initThreadNums_ = threadNums;
+            threadNums_ = threadNums;
+        }
+        reapThreads();
     }
 
-    // 设置线程池工作模式
+    // 设置线程池工作模式，只有ModeScaling策略支持
     void setMode(PoolMode mode) {
         if (checkRuningState()) return;
-        poolMode_ = mode;
+        scaling_.setMode(mode);
     }
 
     // 设置线程池cached模式下线程数量上限
     void setThreadNumMaxThreshHold(int threshHold) {
         if (checkRuningState()) return;
-        if (poolMode_ == PoolMode::MODE_CACHED) {
+        if (scaling_.cached()) {
             threadNumsMaxThreshold_ = threshHold;
         }
     }
@@ -112,123 +801,493 @@ public:
         if (checkRuningState()) return;
         taskNumsMaxThreshhold_ = threshHold;
     }
+    
+    // 设置空闲线程轮询的事件源，poller的生命周期必须长于线程池
+    void setPoller(Poller* poller) {
+        if (checkRuningState()) return;
+        poller_ = poller;
+    }
+    
+    // 设置线程属性：栈大小、nice值、调度策略、是否锁定线程栈
+    // 线程统一命名为pool-N-wK，N为线程池编号，K为线程序号
+    // 属性应用到每个线程上，设置了attr.cpu时线程池的所有线程都绑定到同一个CPU，一般不要给线程池设置
+    void setThreadAttr(const ThreadAttr& attr) {
+        if (checkRuningState()) return;
+        threadAttr_ = attr;
+    }
+    
+    // 设置延迟创建线程：start时不创建线程，之后提交任务时没有空闲线程才创建，直到达到start指定的数量
+    void setLazyStart(bool lazy) {
+        if (checkRuningState()) return;
+        lazyStart_ = lazy;
+    }
+
+    // 加入和其他线程池共享的线程预算，name用于查看预算使用情况，minThreads为保证的最小名额
+    // 线程执行任务前要先拿到名额，budget的生命周期必须长于线程池
+    void setThreadBudget(ThreadBudget& budget, const std::string& name, uint minThreads = 1) {
+        if (checkRuningState()) return;
+        if (budget_ != nullptr) {
+            budget_->detach(budgetSlot_);
+        }
+        budget_ = &budget;
+        budgetSlot_ = budget.attach(name, minThreads);
+    }
+
+    // 设置任务队列已满或字节预算不足时的处理方式，默认等待1s
+    void setAdmissionMode(AdmissionMode mode) {
+        if (checkRuningState()) return;
+        admission_ = mode;
+    }
+
+    // 设置本线程池的字节预算：提交时声明了bytes的任务，从提交到执行完都占用预算
+    void setByteBudget(size_t bytes) {
+        if (checkRuningState()) return;
+        byteBudget_ = bytes;
+    }
+
+    // 设置和其他线程池共享的字节预算，任务需要同时满足本线程池和共享的预算，budget的生命周期必须长于线程池
+    void setGlobalByteBudget(ByteBudget* budget) {
+        if (checkRuningState()) return;
+        globalBudget_ = budget;
+    }
+
+    // 本线程池在途任务（排队和正在执行）的字节数
+    size_t bytesInFlight() const {
+        return bytesInFlight_;
+    }
+
+    // 设置租户的权重和队列上限，只有FairQueue策略支持，可以在运行时调用
+    // 权重决定每轮调度中租户能取出的任务数量，limit为租户队列中任务数量的上限
+    void setTenant(uint tenant, uint weight, size_t limit = TASK_MAX_THRESHHOLD) {
+        std::lock_guard<std::mutex> guard(taskQueMtx_);
+        taskQue_.setTenant(tenant, weight, limit);
+        if (blockedProducers_ > 0) {
+            notFull_.notify_all(); // 上限调大后，等待的提交线程可能可以放入任务了
+        }
+    }
+
+    // 获取租户的统计信息，只有FairQueue策略支持
+    auto tenantStats(uint tenant) {
+        std::lock_guard<std::mutex> guard(taskQueMtx_);
+        return taskQue_.stats(tenant);
+    }
+
+    // 在调用线程上执行一个还没开始的任务，没有可执行的任务返回false
+    // 先取任务队列，队列为空再从各线程的本地缓冲中取（包括调用线程自己的）
+    // 用于等待任务结果的线程帮忙执行任务，避免线程池线程互相等待时死锁
+    bool runPendingTask() {
+        Task task;
+        {
+            std::lock_guard<std::mutex> guard(taskQueMtx_);
+            if (!taskQue_.empty()) {
+                task = taskQue_.pop();
+                if constexpr (WaitPolicy::spins) {
+                    queued_.store(taskQue_.size(), std::memory_order_release);
+                }
+                if (blockedProducers_ > 0) {
+                    notFull_.notify_all();
+                }
+            } else {
+                for (auto& item : localQues_) {
+                    std::unique_lock<std::mutex> vlock(item.second->mtx, std::try_to_lock);
+                    if (vlock.owns_lock() && !item.second->tasks.empty()) {
+                        task = std::move(item.second->tasks.back());
+                        item.second->tasks.pop_back();
+                        stats_.onSteal(1);
+                        break;
+                    }
+                }
+                if (task == nullptr) return false;
+            }
+            if constexpr (ScalingPolicy::canGrow) {
+                --taskNums_;
+            }
+        }
+        runTask(task);
+        return true;
+    }
+
+    // 按键提交、还在排队或执行的任务数量
+    size_t keyedTasks() {
+        return keyed_.size();
+    }
+
+    // 获取统计策略对象
+    const StatsPolicy& stats() const {
+        return stats_;
+    }
 
     // 给线程池提交任务
     // 使用可变参模板编程，让其可以接受任意任务函数和任意数量的参数
-    template<typename Func, typename... Args>
+    template<typename Func, typename... Args,
+             typename = typename std::enable_if<!std::is_same<typename std::decay<Func>::type, TaskMeta>::value>::type>
     auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+        return submitTask(TaskMeta(), std::forward<Func>(func), std::forward<Args>(args)...);
+    }
+
+    // 带附加信息提交任务，如指定任务所属的租户、任务期限
+    // 任务开始执行时已经超过期限则不执行，future抛出errc::timed_out的std::system_error
+    template<typename Func, typename... Args>
+    auto submitTask(const TaskMeta& meta, Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
         // 打包任务，放入任务队列
         using RType = decltype(func(args...));
-        auto task = std::make_shared<std::packaged_task<RType()>>(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+        auto fn = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+        std::shared_ptr<std::packaged_task<RType()>> task;
+        if (meta.hasDeadline()) {
+            task = std::make_shared<std::packaged_task<RType()>>([this, fn = std::move(fn), meta]() mutable -> RType {
+                if (meta.expired()) {
+                    stats_.onExpire();
+                    throw deadlineExpired();
+                }
+                return fn();
+            });
+        } else {
+            task = std::make_shared<std::packaged_task<RType()>>(std::move(fn));
+        }
         std::future<RType> result = task->get_future();
-                              
-        // 获取锁
-        std::unique_lock<std::mutex> ulock(taskQueMtx_);
-
-        auto pred = [&]() -> bool {
-            return taskQue_.size() < taskNumsMaxThreshhold_;
-        };
-        if (!notFull_.wait_for(ulock, std::chrono::seconds(1), pred)) {
-            // 表示等待1s后，条件依然不满足
-            std::cerr << "task queue is full, submit task fail." << std::endl;
+        
+        if (!enqueue([task]() { (*task)(); }, meta)) {
             auto task = std::make_shared<std::packaged_task<RType()>>([]() -> RType {
                 return RType();
             });
             (*task)();
             return task->get_future();
         }
-                              
-        // 将任务添加进任务队列中
-        taskQue_.emplace([task]() { (*task)(); });
-        ++taskNums_;
-                              
-        // 任务队列中新增了任务，任务队列肯定不空，notEmpty_上通知消费
-        notEmpty_.notify_all();
-                                  
-        // cached模式，场景为使用小而快的任务；根据任务数量和空闲线程的数量，判断是否需要创建爱你新的线程出来
-        if (poolMode_ == PoolMode::MODE_CACHED
-            && taskNums_ > idleThreadNums_
-            && threadNums_ < threadNumsMaxThreshold_) {
-                            
-            std::cout << " ===>>> creeate new thread <<<=== " << std::endl;
-                                    
-            // 创建新线程
-            auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-            uint threadId = ptr->getId();
-            threads_.emplace(threadId, std::move(ptr)); // unique_ptr只能右值拷贝
-            threads_[threadId]->start();
-            //        threads_.emplace_back(std::move(ptr));
-            ++threadNums_;
-            ++idleThreadNums_;
-        }
                             
         // 返回任务的Result对象
         //    return task->getResult(); // 线程执行完task，task对象就被析构了，依赖于task对象的Result对象也没了，这种方式不行。
         return result;
-                              
+    }
+    
+    // 提交不需要返回值的任务，不创建packaged_task和future，是开销最小的提交方式
+    // 任务抛出的异常只打印错误，不会传给调用者；提交失败返回false
+    template<typename Func>
+    bool post(Func&& func) {
+        return enqueue(Task(std::forward<Func>(func)));
+    }
+
+    // 任务开始执行时已经超过期限则直接跳过
+    template<typename Func>
+    bool post(const TaskMeta& meta, Func&& func) {
+        if (!meta.hasDeadline()) {
+            return enqueue(Task(std::forward<Func>(func)), meta);
+        }
+        return enqueue([this, f = std::forward<Func>(func), meta]() mutable {
+            if (meta.expired()) {
+                stats_.onExpire();
+                return;
+            }
+            f();
+        }, meta);
+    }
+    
+    // 提交任务，任务完成后在执行任务的线程上直接调用onDone，不创建future
+    // func返回void时调用onDone(std::exception_ptr)，否则调用onDone(std::exception_ptr, std::optional<返回值类型>)
+    // 任务抛出异常时exception_ptr非空，optional为空；任务被ABORT/DEADLINE关闭丢弃时，onDone在丢弃任务的线程上收到broken_promise
+    // 提交失败返回false，onDone不会被调用
+    template<typename Func, typename Callback>
+    bool submitWithCallback(Func&& func, Callback&& onDone) {
+        return submitWithCallback(TaskMeta(), std::forward<Func>(func), std::forward<Callback>(onDone));
+    }
+
+    // 任务开始执行时已经超过期限则不执行，onDone收到errc::timed_out的std::system_error
+    template<typename Func, typename Callback>
+    bool submitWithCallback(const TaskMeta& meta, Func&& func, Callback&& onDone) {
+        using RType = decltype(std::declval<typename std::decay<Func>::type&>()());
+        auto guard = std::make_shared<CallbackGuard<RType, typename std::decay<Callback>::type>>(
+            std::forward<Callback>(onDone));
+        bool ok = enqueue([this, f = std::forward<Func>(func), guard, meta]() mutable {
+            guard->done = true;
+            std::exception_ptr e;
+            bool expired = meta.expired();
+            if (expired) {
+                stats_.onExpire();
+                e = std::make_exception_ptr(deadlineExpired());
+            }
+            if constexpr (std::is_void<RType>::value) {
+                try {
+                    if (!expired) f();
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                guard->cb(e);
+            } else {
+                std::optional<RType> value;
+                try {
+                    if (!expired) value.emplace(f());
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                guard->cb(e, std::move(value));
+            }
+        }, meta);
+        if (!ok) {
+            guard->done = true; // 提交失败由返回值告知调用者，不调用onDone
+        }
+        return ok;
+    }
+
+    // 按键提交任务：相同键的任务还在排队或执行时不再重复提交，直接返回已有任务的结果
+    // 任务执行完就从在途任务表中删除，之后相同键的提交会重新执行；相同键必须对应相同的返回值类型
+    // 提交失败时所有等待这个结果的调用者得到默认构造的值
+    template<typename Func>
+    auto submitKeyed(const std::string& key, Func&& func) -> std::shared_future<decltype(func())> {
+        using RType = decltype(func());
+        auto& shard = keyed_.shard(key);
+        auto promise = std::make_shared<std::promise<RType>>();
+        auto result = std::make_shared<std::shared_future<RType>>(promise->get_future().share());
+        bool mismatch = false;
+        {
+            std::lock_guard<std::mutex> guard(shard.mtx);
+            auto it = shard.entries.find(key);
+            if (it == shard.entries.end()) {
+                shard.entries.emplace(key, InFlightTable::Entry{std::type_index(typeid(RType)), result});
+            } else if (it->second.type == std::type_index(typeid(RType))) {
+                stats_.onDedup();
+                return *static_cast<std::shared_future<RType>*>(it->second.result.get());
+            } else {
+                mismatch = true;
+            }
+        }
+        if (mismatch) {
+            // 返回值类型不同，不去重，按普通任务提交
+            std::cerr << "keyed task type mismatch, key: " << key << std::endl;
+            return submitTask(std::forward<Func>(func)).share();
+        }
+        
+        // 任务没有执行就被丢弃时（ABORT关闭）也要删除表项，否则之后相同键的提交一直拿到broken_promise
+        std::shared_ptr<void> cleanup(nullptr, [this, key, result](void*) {
+            keyed_.erase(key, result.get());
+        });
+        
+        // 不持有分片的锁提交，队列满时等待不影响其他键
+        bool ok = enqueue([this, promise, result, cleanup, key, f = std::forward<Func>(func)]() mutable {
+            // 先算出结果，从表中删除，再通知等待的调用者
+            try {
+                if constexpr (std::is_void<RType>::value) {
+                    f();
+                    keyed_.erase(key, result.get());
+                    promise->set_value();
+                } else {
+                    RType value = f();
+                    keyed_.erase(key, result.get());
+                    promise->set_value(std::move(value));
+                }
+            } catch (...) {
+                keyed_.erase(key, result.get());
+                promise->set_exception(std::current_exception());
+            }
+        });
+        if (!ok) {
+            keyed_.erase(key, result.get());
+            if constexpr (std::is_void<RType>::value) {
+                promise->set_value();
+            } else {
+                promise->set_value(RType());
+            }
+        }
+        return *result;
     }
 
     // 启动线程池
     void start(int initThreadNums) {
+        std::unique_lock<std::mutex> ulock(taskQueMtx_);
+        if (isRuning_) return;
+        
         // 设置线程池运行状态
         isRuning_ = true;
+        isStopped_ = false;
+        retireThreadNums_ = 0;
         
         // 记录线程池初始线程个数
         initThreadNums_ = initThreadNums;
         threadNums_ = initThreadNums;
 
-        // 创建线程对象
-        for (int i = 0; i < initThreadNums_; ++i) {
-            // 创建线程对象的时候，需要把线程函数给到线程对象
-            auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-            uint threadId = ptr->getId();
-            threads_.emplace(threadId, std::move(ptr));
-    //        threads_.emplace_back(std::move(ptr)); // unique_ptr只能右值拷贝
-        }
-
-        // 启动所有线程
-        for (int i = 0; i < initThreadNums_; ++i) {
-            threads_[i]->start(); // 需要执行一个线程函数
-            ++idleThreadNums_; // 每启动一个线程，空闲线程数量就加一
+        // 创建并启动线程，延迟创建模式下等到提交任务时再创建
+        if (!lazyStart_) {
+            for (int i = 0; i < initThreadNums; ++i) {
+                spawnThread();
+            }
         }
     }
 
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
+    BasicThreadPool(const BasicThreadPool&) = delete;
+    BasicThreadPool& operator=(const BasicThreadPool&) = delete;
 
 private:
+    using Task = PoolTask;
+    
+    // 任务占用的字节预算，任务执行完或者被丢弃（析构）时归还
+    struct ByteCharge {
+        ByteCharge(BasicThreadPool* p, ByteBudget* g) : pool(p), global(g), bytes(0) {}
+        ~ByteCharge() {
+            if (bytes > 0) {
+                pool->releaseBytes(global, bytes);
+            }
+        }
+        // 任务执行完（包括抛出异常）立即归还，不等任务对象析构
+        struct Release {
+            std::shared_ptr<ByteCharge>& charge;
+            ~Release() { charge.reset(); }
+        };
+        BasicThreadPool* pool;
+        ByteBudget* global; // 入队前已经申请的共享预算
+        size_t bytes; // 入队成功后才设置，之前析构不归还
+    };
+
+    // submitWithCallback的回调，任务没有执行就析构（被ABORT/DEADLINE丢弃）时用broken_promise调用回调
+    template<typename RType, typename Callback>
+    struct CallbackGuard {
+        template<typename C>
+        explicit CallbackGuard(C&& c) : cb(std::forward<C>(c)), done(false) {}
+        CallbackGuard(const CallbackGuard&) = delete;
+        CallbackGuard& operator=(const CallbackGuard&) = delete;
+        ~CallbackGuard() {
+            if (done) return;
+            auto e = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+            try {
+                if constexpr (std::is_void<RType>::value) {
+                    cb(e);
+                } else {
+                    cb(e, std::optional<RType>());
+                }
+            } catch (const std::exception& ex) {
+                std::cerr << "task callback throw exception: " << ex.what() << std::endl;
+            } catch (...) {
+                std::cerr << "task callback throw unknown exception" << std::endl;
+            }
+        }
+
+        Callback cb;
+        bool done; // 任务是否已经执行（或提交失败），之后析构不再调用回调
+    };
+
+    // 线程私有的任务缓冲：线程一次从任务队列批量取出多个任务放在这里，其他空闲线程可以从中窃取
+    struct LocalQueue {
+        std::mutex mtx; // 本地缓冲的锁，只和窃取者竞争
+        std::deque<Task> tasks; // 从任务队列批量取出、还未执行的任务
+        double avgTaskNs = 0; // 任务平均执行时间（纳秒），用于调整批量大小
+    };
+    
     // 定义线程函数
     void threadFunc(uint threadid) {
     //    std::cout << "begin threadFunc tid: " << std::this_thread::get_id()
     //        << std::endl;
         auto lastTime = std::chrono::high_resolution_clock().now();
         
+        auto local = std::make_shared<LocalQueue>();
+        {
+            std::lock_guard<std::mutex> guard(taskQueMtx_);
+            localQues_.emplace(threadid, local);
+        }
+        
+        bool busy = false; // 当前线程是否正在执行一批任务
+        bool timed = false; // 当前这批是否计时，只有一批多于一个任务时才读时钟，单个任务的唤醒不付出计时的开销
+        ThreadBudget::Holder token{budget_, budgetSlot_, false}; // 线程预算的名额
+        if (budget_ != nullptr) {
+            ThreadBudget::current() = &token; // 任务中的BlockingScope通过它让出名额
+        }
+        size_t batchCount = 0; // 当前这批已执行的任务数量
+        std::chrono::steady_clock::time_point batchBegin;
+        
         // 所有任务必须执行完成，才能回收线程资源
         for (;;) {
             Task task;
+            
+            // 先执行本地缓冲中的任务
             {
+                std::lock_guard<std::mutex> guard(local->mtx);
+                if (!local->tasks.empty()) {
+                    task = std::move(local->tasks.front());
+                    local->tasks.pop_front();
+                }
+            }
+            
+            if (task == nullptr) {
+                // 本地缓冲执行完了，统计这批任务的平均执行时间，线程重新变为空闲
+                if (busy) {
+                    if (timed) {
+                        auto now = std::chrono::steady_clock::now();
+                        double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(now - batchBegin).count());
+                        double avg = ns / batchCount;
+                        local->avgTaskNs = local->avgTaskNs == 0 ? avg : local->avgTaskNs * 0.75 + avg * 0.25;
+                    }
+                    busy = false;
+                    // 有其他线程在等待预算名额，执行完这批任务就让出
+                    if (token.held && budget_->contended()) {
+                        token.release();
+                    }
+                    if constexpr (ScalingPolicy::canGrow) {
+                        ++idleThreadNums_;
+                        // 更新线程执行完任务的时间
+                        lastTime = std::chrono::high_resolution_clock().now();
+                    }
+                }
+                
                 // 先获取锁
                 std::unique_lock<std::mutex> ulock(taskQueMtx_);
-                std::cout << "tid: " << std::this_thread::get_id() << " get task from queue!"
-                    << std::endl;
+                
+                // resize缩减了线程数量，当前线程手头的任务已经执行完，退出
+                // 队列中还有任务时，最后一个线程不退出
+                if (retireThreadNums_ > 0 && (taskQue_.empty() || threads_.size() > 1)) {
+                    --retireThreadNums_;
+                    token.release();
+                    exitThread(threadid);
+                    return;
+                }
                 
                 // cached模式下，创建出来的线程若空闲时间超过60s（当前时间 - 上一次线程执行的时间），应该将其回收
                 // 超过initThreadNums_数量的线程要回收
                 // 双重判断 + 锁：预防死锁
+                timed = false;
                 while (taskQue_.size() == 0) { // 没有任务才看看要不要回收线程
-                    // 线程池要结束，回收线程资源
-                    if (!isRuning_) {
-                        threads_.erase(threadid);
-                        std::cout << "threadid: " << std::this_thread::get_id()
-                            << " exit!" << std::endl;
-                        exitCond_.notify_all(); // 通知主线程
+                    // 任务队列空了，去其他线程的本地缓冲中窃取任务
+                    if (size_t n = stealTask(threadid, *local, task)) {
+                        timed = n > 1;
+                        break;
+                    }
+                    
+                    // 线程池要结束，或者resize缩减了线程数量，回收线程资源
+                    if (!isRuning_ || retireThreadNums_ > 0) {
+                        if (isRuning_) {
+                            --retireThreadNums_;
+                        }
+                        token.release();
+                        exitThread(threadid);
                         return; // 线程函数结束，线程结束
                     }
                     
-                    if (poolMode_ == PoolMode::MODE_CACHED) {
+                    // 没有任务可执行，挂起或轮询前让出预算名额
+                    token.release();
+                    
+                    // 没有其他线程在轮询事件源，当前线程去轮询，轮询期间释放锁
+                    if (poller_ != nullptr && !polling_) {
+                        polling_ = true;
+                        ulock.unlock();
+                        poller_->poll(scaling_.cached() ? 1000 : -1);
+                        ulock.lock();
+                        polling_ = false;
+                        lastTime = std::chrono::high_resolution_clock().now();
+                        continue;
+                    }
+                    
+                    // 自旋等待策略：释放锁自旋一段时间，期间有任务入队就不必挂起
+                    if constexpr (WaitPolicy::spins) {
+                        ulock.unlock();
+                        bool ready = WaitPolicy::spin([this]() -> bool {
+                            return queued_.load(std::memory_order_acquire) > 0;
+                        });
+                        ulock.lock();
+                        if (ready || !taskQue_.empty()) continue;
+                    }
+                    
+                    ++parkedThreadNums_;
+                    if (ScalingPolicy::canGrow && scaling_.cached()) {
                         // 条件变量超时返回，每秒中返回一次
-                        if (std::cv_status::timeout
-                            == notEmpty_.wait_for(ulock, std::chrono::seconds(1))) {
+                        bool timeout = std::cv_status::timeout
+                            == notEmpty_.wait_for(ulock, std::chrono::seconds(1));
+                        --parkedThreadNums_;
+                        if (timeout) {
                             auto now = std::chrono::high_resolution_clock().now();
                             auto dur = std::chrono::duration_cast<std::chrono::seconds>(now - lastTime);
                             if (dur.count() >= THREAD_MAX_IDLE_TIME
@@ -236,77 +1295,386 @@ private:
                                 // 回收当前线程
                                 // 更改线程数量相关值
                                 // 线程列表中移除线程对象，通过threadid找到线程对象然后再移除
-                                threads_.erase(threadid);
                                 --threadNums_;
-                                --idleThreadNums_;
-                                
-                                std::cout << "threadid: " << std::this_thread::get_id()
-                                    << " exit!" << std::endl;
+                                exitThread(threadid);
                                 return;
                             }
                         }
                     } else {
                         notEmpty_.wait(ulock);
+                        --parkedThreadNums_;
                     }
                 }
                 
-                --idleThreadNums_;
-                std::cout << "tid: " << std::this_thread::get_id() << " get task success!"
-                    << std::endl;
-
-                // 取出一个任务
-                task = taskQue_.front();
-                taskQue_.pop();
-                --taskNums_;
-
-                // 队列中不止一个任务，通知其他线程获取任务
-                if (taskNums_ > 0) {
-                    notEmpty_.notify_all();
+                if (task == nullptr) {
+                    // 一次取出一批任务：第一个立即执行，其余放入本地缓冲，减少加锁次数
+                    size_t queSize = taskQue_.size();
+                    size_t batch = batchSize(*local, queSize);
+                    task = taskQue_.pop();
+                    if (batch > 1) {
+                        std::lock_guard<std::mutex> guard(local->mtx);
+                        for (size_t i = 1; i < batch; ++i) {
+                            local->tasks.emplace_back(taskQue_.pop());
+                        }
+                    }
+                    if constexpr (WaitPolicy::spins) {
+                        queued_.store(taskQue_.size(), std::memory_order_release);
+                    }
+                    stats_.onBatch(batch);
+                    timed = batch > 1;
+                    
+                    // 队列中还有任务，或者本地缓冲中有可窃取的任务，通知一个空闲线程
+                    if (!taskQue_.empty()
+                        || (batch > 1 && (!ScalingPolicy::canGrow || idleThreadNums_ > 1))) {
+                        notEmpty_.notify_one();
+                    }
+                    
+                    // 有提交线程在等待队列不满，notFull_上通知生产
+                    if (blockedProducers_ > 0) {
+                        notFull_.notify_all();
+                    }
+                }
+                
+                if constexpr (ScalingPolicy::canGrow) {
+                    --idleThreadNums_;
+                }
+                busy = true;
+                batchCount = 0;
+                if (timed) {
+                    batchBegin = std::chrono::steady_clock::now();
                 }
-
-                // 取出任务，队列不满了，notFull_上通知生产
-                notFull_.notify_all();
             } // 锁释放，其他线程可以获取锁操作任务队列
+            
+            // 加入了线程预算，执行任务前先拿到名额
+            if (budget_ != nullptr) {
+                token.acquire();
+            }
 
-            // 当前线程执行该任务
-            if (task != nullptr) {
-                task(); // 执行function<void()>;
+            if constexpr (ScalingPolicy::canGrow) {
+                --taskNums_;
             }
+            ++batchCount;
             
-            ++idleThreadNums_;
-            // 更新线程执行完任务的时间
-            lastTime = std::chrono::high_resolution_clock().now();
+            // 当前线程执行该任务
+            runTask(task); // 执行function<void()>;
         }
         
     //    std::cout << "end threadFunc tid: " << std::this_thread::get_id()
     //        << std::endl;
     }
     
+    // 把任务放入任务队列，队列满等待1s仍然放不进去或者线程池已经关闭时返回false
+    // 除了整个队列的上限，任务队列策略也可以按meta拒绝（如租户队列已满），同样等待1s
+    // 任务声明了bytes时还要满足字节预算，REJECT模式下不等待
+    bool enqueue(Task&& task, const TaskMeta& meta = TaskMeta()) {
+        // 共享预算和本线程池的等待共用同一个期限，总共最多等待1s
+        // 只有可能等待时才读时钟，不声明字节、队列不满的提交不读时钟
+        std::chrono::milliseconds timeout(admission_ == AdmissionMode::BLOCK ? 1000 : 0);
+        std::chrono::steady_clock::time_point deadline;
+        bool hasDeadline = false;
+        std::shared_ptr<ByteCharge> charge;
+        if (meta.bytes > 0) {
+            // 先申请共享的字节预算，不持有taskQueMtx_等待
+            ByteBudget* global = globalBudget_;
+            if (global != nullptr && timeout.count() > 0) {
+                deadline = std::chrono::steady_clock::now() + timeout;
+                hasDeadline = true;
+            }
+            if (global != nullptr && !global->acquire(meta.bytes, timeout)) {
+                std::lock_guard<std::mutex> guard(taskQueMtx_);
+                taskQue_.onReject(meta);
+                std::cerr << "global byte budget is exhausted, submit task fail." << std::endl;
+                return false;
+            }
+            // 任务执行完或者被丢弃时归还预算，入队成功前charge不占用本线程池的预算
+            charge = std::make_shared<ByteCharge>(this, global);
+            task = [t = std::move(task), charge]() mutable {
+                typename ByteCharge::Release release{charge};
+                t();
+            };
+        }
+
+        // 获取锁
+        std::unique_lock<std::mutex> ulock(taskQueMtx_);
+
+        auto queueFull = [&]() -> bool {
+            return taskQue_.size() >= taskNumsMaxThreshhold_ || !taskQue_.canPush(meta);
+        };
+        auto bytesFull = [&]() -> bool {
+            return meta.bytes > 0 && bytesInFlight_ > 0 && bytesInFlight_ + meta.bytes > byteBudget_;
+        };
+        auto pred = [&]() -> bool {
+            return isStopped_ || (!queueFull() && !bytesFull());
+        };
+        bool ready = pred();
+        if (!ready && timeout.count() > 0) {
+            if (!hasDeadline) {
+                deadline = std::chrono::steady_clock::now() + timeout;
+            }
+            ++blockedProducers_;
+            ready = notFull_.wait_until(ulock, deadline, pred);
+            --blockedProducers_;
+        }
+        if (!ready || isStopped_) {
+            // 表示等到期限后，条件依然不满足，或者线程池已经关闭
+            const char* reason = isStopped_ ? "thread pool is shut down"
+                : taskQue_.size() >= taskNumsMaxThreshhold_ ? "task queue is full"
+                : !taskQue_.canPush(meta) ? "tenant queue limit is reached" : "pool byte budget is exhausted";
+            if (!isStopped_) {
+                taskQue_.onReject(meta);
+            }
+            ulock.unlock();
+            if (charge && charge->global != nullptr) {
+                charge->global->release(meta.bytes);
+            }
+            std::cerr << reason << ", submit task fail." << std::endl;
+            return false;
+        }
+                              
+        // 将任务添加进任务队列中
+        if (charge) {
+            charge->bytes = meta.bytes;
+            bytesInFlight_ += meta.bytes;
+        }
+        taskQue_.push(std::move(task), meta);
+        if constexpr (ScalingPolicy::canGrow) {
+            ++taskNums_;
+        }
+        if constexpr (WaitPolicy::spins) {
+            queued_.store(taskQue_.size(), std::memory_order_release);
+        }
+        stats_.onSubmit();
+                              
+        // 任务队列由空变为不空，notEmpty_上通知一个线程消费
+        // 队列原本不空时已经有线程被通知过，取任务的线程发现队列还有剩余会继续通知下一个线程
+        if (taskQue_.size() == 1) {
+            notEmpty_.notify_one();
+        }
+        
+        // 延迟创建模式，线程数量还没达到start指定的数量，并且排队的任务比空闲（挂起或轮询）的线程多时才创建线程
+        if (lazyStart_
+            && threads_.size() - retireThreadNums_ < initThreadNums_
+            && taskQue_.size() > parkedThreadNums_ + (polling_ ? 1 : 0)) {
+            spawnThread();
+        }
+        
+        // 只剩轮询线程空闲，唤醒它来执行任务；不统计空闲线程数时总是唤醒
+        if (polling_ && (!ScalingPolicy::canGrow || idleThreadNums_ <= 1)) {
+            poller_->wakeup();
+        }
+                                  
+        // cached模式，场景为使用小而快的任务；根据任务数量和空闲线程的数量，判断是否需要创建爱你新的线程出来
+        if constexpr (ScalingPolicy::canGrow) {
+            if (scaling_.cached()
+                && taskNums_ > idleThreadNums_
+                && threadNums_ < threadNumsMaxThreshold_) {
+                
+                std::cout << " ===>>> creeate new thread <<<=== " << std::endl;
+                
+                // 创建新线程
+                spawnThread();
+                ++threadNums_;
+            }
+        }
+        return true;
+    }
+    
+    // 执行一个任务。submitTask的任务异常由packaged_task保存，这里只会捕获到post的任务抛出的异常
+    void runTask(Task& task) {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "task throw exception: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "task throw unknown exception" << std::endl;
+        }
+        stats_.onExecute();
+    }
+    
+    // 创建并启动一个线程，调用时持有taskQueMtx_
+    void spawnThread() {
+        // 创建线程对象的时候，需要把线程函数给到线程对象
+        std::string name = "pool-" + std::to_string(poolId_) + "-w" + std::to_string(workerSeq_++);
+        auto ptr = std::make_unique<Thread>(std::bind(&BasicThreadPool::threadFunc, this, std::placeholders::_1),
+                                            threadAttr_, std::move(name));
+        uint threadId = ptr->getId();
+        auto it = threads_.emplace(threadId, std::move(ptr)).first; // unique_ptr只能右值拷贝
+        if (!it->second->start()) { // 需要执行一个线程函数
+            threads_.erase(it);
+            return;
+        }
+        if constexpr (ScalingPolicy::canGrow) {
+            ++idleThreadNums_; // 每启动一个线程，空闲线程数量就加一
+        }
+    }
+    
+    // 线程退出前调用，调用时持有taskQueMtx_
+    // 线程不能join自己，把线程对象移到finished_中，由之后退出的线程或者shutdown/resize来join
+    void exitThread(uint threadid) {
+        for (auto& t : finished_) {
+            t->join(); // 这些线程已经释放了锁，马上就会返回
+        }
+        finished_.clear();
+        
+        auto it = threads_.find(threadid);
+        finished_.emplace_back(std::move(it->second));
+        threads_.erase(it);
+        localQues_.erase(threadid);
+        if constexpr (ScalingPolicy::canGrow) {
+            --idleThreadNums_;
+        }
+        std::cout << "threadid: " << std::this_thread::get_id()
+            << " exit!" << std::endl;
+        exitCond_.notify_all(); // 通知主线程
+    }
+    
+    // join已经退出的线程
+    void reapThreads() {
+        std::vector<std::unique_ptr<Thread>> finished;
+        {
+            std::lock_guard<std::mutex> guard(taskQueMtx_);
+            finished.swap(finished_);
+        }
+        for (auto& t : finished) {
+            t->join();
+        }
+    }
+    
+    // 丢弃任务队列和各线程本地缓冲中还没执行的任务，调用时持有taskQueMtx_
+    // 任务在释放锁之后析构，packaged_task析构时对应的future得到broken_promise异常
+    void abortTasks(std::unique_lock<std::mutex>& ulock) {
+        std::vector<Task> dropped;
+        while (!taskQue_.empty()) {
+            dropped.emplace_back(taskQue_.pop());
+        }
+        for (auto& item : localQues_) {
+            std::lock_guard<std::mutex> guard(item.second->mtx);
+            for (auto& task : item.second->tasks) {
+                dropped.emplace_back(std::move(task));
+            }
+            item.second->tasks.clear();
+        }
+        if constexpr (ScalingPolicy::canGrow) {
+            taskNums_ -= dropped.size();
+        }
+        if constexpr (WaitPolicy::spins) {
+            queued_.store(0, std::memory_order_release);
+        }
+        ulock.unlock();
+        dropped.clear();
+        ulock.lock();
+    }
+    
+    // 根据队列长度和任务平均执行时间决定一次取出的任务数量
+    // 队列中的任务平均分给各线程；任务越短，一次取得越多，单批执行时间控制在TASK_BATCH_TARGET_NS左右
+    // 按已经创建的线程数量平均，延迟创建模式下还没创建的线程不算在内；调用时持有taskQueMtx_
+    size_t batchSize(const LocalQueue& local, size_t queSize) const {
+        size_t workers = std::max<size_t>(1, threads_.size() - retireThreadNums_);
+        size_t batch = (queSize + workers - 1) / workers;
+        if (local.avgTaskNs > 0) {
+            batch = std::min(batch, size_t(TASK_BATCH_TARGET_NS / local.avgTaskNs) + 1);
+        }
+        return std::max<size_t>(1, std::min<size_t>(batch, TASK_MAX_BATCH));
+    }
+    
+    // 从其他线程的本地缓冲尾部窃取一半任务，返回窃取的任务数量，调用时持有taskQueMtx_
+    size_t stealTask(uint threadid, LocalQueue& local, Task& task) {
+        for (auto& item : localQues_) {
+            if (item.first == threadid) continue;
+            LocalQueue& victim = *item.second;
+            std::unique_lock<std::mutex> vlock(victim.mtx, std::try_to_lock);
+            if (!vlock.owns_lock() || victim.tasks.empty()) continue;
+            
+            size_t n = (victim.tasks.size() + 1) / 2;
+            std::vector<Task> stolen;
+            stolen.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                stolen.emplace_back(std::move(victim.tasks.back()));
+                victim.tasks.pop_back();
+            }
+            vlock.unlock();
+            
+            stats_.onSteal(n);
+            task = std::move(stolen.back());
+            stolen.pop_back();
+            if (!stolen.empty()) {
+                std::lock_guard<std::mutex> guard(local.mtx);
+                for (auto it = stolen.rbegin(); it != stolen.rend(); ++it) {
+                    local.tasks.emplace_back(std::move(*it));
+                }
+            }
+            return n;
+        }
+        return 0;
+    }
+    
+    // 归还任务占用的字节预算
+    void releaseBytes(ByteBudget* global, size_t bytes) {
+        {
+            std::lock_guard<std::mutex> guard(taskQueMtx_);
+            bytesInFlight_ -= bytes;
+            if (blockedProducers_ > 0) {
+                notFull_.notify_all();
+            }
+        }
+        if (global != nullptr) {
+            global->release(bytes);
+        }
+    }
+
     // 检查线程池的运行状态
     bool checkRuningState() const {
         return isRuning_;
     }
 private:
-    PoolMode poolMode_; // 当前线程池的工作模式
+    ScalingPolicy scaling_; // 伸缩策略，决定当前线程池的工作模式
+    StatsPolicy stats_; // 统计策略
     std::atomic_bool isRuning_; // 判断线程池的运行状态
+    bool isStopped_; // 线程池已关闭，不再接收任务，由taskQueMtx_保护
 
     std::unordered_map<uint, std::unique_ptr<Thread>> threads_; // 线程列表
+    std::vector<std::unique_ptr<Thread>> finished_; // 已经退出、等待join的线程
+    uint retireThreadNums_; // resize后需要退出的线程数量，由taskQueMtx_保护
+    uint poolId_; // 线程池编号
+    uint workerSeq_; // 线程序号，用于线程命名
+    ThreadAttr threadAttr_; // 线程属性
+    bool lazyStart_; // 是否延迟创建线程
+    AdmissionMode admission_; // 任务队列已满或字节预算不足时的处理方式
+    size_t byteBudget_; // 本线程池在途任务的字节上限
+    std::atomic<size_t> bytesInFlight_; // 本线程池在途任务的字节数，由taskQueMtx_保护写入
+    ByteBudget* globalBudget_; // 多个线程池共享的字节预算
     size_t initThreadNums_; // 初始的线程数量
     std::atomic_uint threadNums_;  // 线程池中线程总数量
     size_t threadNumsMaxThreshold_; // 线程数量的上限
     std::atomic_uint idleThreadNums_; // 空闲线程的数量
 
-    using Task = std::function<void()>;
-    std::queue<Task> taskQue_; // 任务队列
+    QueuePolicy taskQue_; // 任务队列
+    std::atomic<size_t> queued_; // 任务队列长度，供自旋等待的线程无锁读取，只在SpinParkWait策略下维护
+    std::unordered_map<uint, std::shared_ptr<LocalQueue>> localQues_; // 各线程的本地任务缓冲，由taskQueMtx_保护
     std::atomic_uint taskNums_; // 任务数量
     size_t taskNumsMaxThreshhold_; // 任务队列中任务数量的上限
+    uint blockedProducers_; // 等待任务队列不满的提交线程数量，由taskQueMtx_保护
 
     std::mutex taskQueMtx_; // 保证任务队列线程安全的互斥锁
     std::condition_variable notFull_; // 表示任务队列不满
     std::condition_variable notEmpty_; // 表示任务队列不空
     std::condition_variable exitCond_; // 等待线程资源全部回收
+    
+    Poller* poller_; // 空闲线程轮询的事件源
+    bool polling_; // 是否有线程正在轮询事件源，由taskQueMtx_保护
+    size_t parkedThreadNums_; // 挂起在notEmpty_上的线程数量，由taskQueMtx_保护
+
+    InFlightTable keyed_; // 按键提交的在途任务
+
+    ThreadBudget* budget_; // 和其他线程池共享的线程预算
+    ThreadBudget::Slot* budgetSlot_; // 本线程池在预算中的槽位
 };
 
+// 默认线程池：通过setMode在运行前切换fixed/cached模式
+using ThreadPool = BasicThreadPool<>;
+
+// 最精简的固定线程数线程池：环形缓冲任务队列，不维护伸缩计数，不统计
+using FixedThreadPool = BasicThreadPool<RingQueue, ParkWait, FixedScaling, NoStats>;
 
 #endif /* ryanthreadpool_h */
 
@@ -0,0 +1,175 @@
+//
+//  TaskGroup.h
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+#ifndef taskgroup_h
+#define taskgroup_h
+
+#include "RyanThreadPool.h"
+
+#include <exception>
+#include <stdexcept>
+
+// 协作式取消令牌，拷贝之间共享同一个取消状态
+class CancellationToken {
+public:
+    CancellationToken()
+        : cancelled_(std::make_shared<std::atomic_bool>(false)) {}
+
+    // 请求取消
+    void cancel() {
+        cancelled_->store(true, std::memory_order_release);
+    }
+
+    // 是否已经请求取消，长任务可以在执行过程中检查它提前返回
+    bool isCancelled() const {
+        return cancelled_->load(std::memory_order_acquire);
+    }
+private:
+    std::shared_ptr<std::atomic_bool> cancelled_;
+};
+
+/*
+example:
+ TaskGroup group(pool);
+ for (auto& req : requests) {
+     group.run([&req](const CancellationToken& token) {
+         if (token.isCancelled()) return;
+         handle(req);
+     });
+ }
+ group.wait(); // 等待全部完成，重新抛出第一个异常
+*/
+
+// 任务组：一组任务共用一个原子计数器，wait一次等待全部完成，不需要为每个任务等待future
+// 第一个抛出的异常会取消整个任务组，已取消的任务在出队时直接跳过，不再执行
+template<typename Pool = ThreadPool>
+class BasicTaskGroup {
+public:
+    explicit BasicTaskGroup(Pool& pool)
+        : pool_(pool)
+        , state_(std::make_shared<State>()) {}
+
+    // 等待剩余任务完成，析构时不再抛出异常
+    ~BasicTaskGroup() {
+        try {
+            wait();
+        } catch (...) {}
+    }
+
+    BasicTaskGroup(const BasicTaskGroup&) = delete;
+    BasicTaskGroup& operator=(const BasicTaskGroup&) = delete;
+
+    // 提交一个任务，func可以不带参数，也可以接收const CancellationToken&
+    // 提交失败或任务被线程池丢弃（ABORT/DEADLINE关闭）时，wait抛出std::runtime_error
+    template<typename Func>
+    void run(Func&& func) {
+        state_->pending.fetch_add(1, std::memory_order_relaxed);
+        auto guard = std::make_shared<Guard>(state_);
+        bool ok = pool_.post([guard, f = std::forward<Func>(func)]() mutable {
+            State& state = *guard->state;
+            if (!state.token.isCancelled()) {
+                try {
+                    if constexpr (std::is_invocable<decltype(f)&, const CancellationToken&>::value) {
+                        f(state.token);
+                    } else {
+                        f();
+                    }
+                } catch (...) {
+                    state.setException(std::current_exception());
+                }
+            }
+            guard->done = true;
+            state.finish();
+        });
+        if (!ok) {
+            guard->error = "task group submit task fail";
+        }
+    }
+
+    // 等待组内所有任务完成，等待期间帮忙执行线程池队列中的任务
+    // 有任务抛出异常时，重新抛出第一个异常
+    void wait() {
+        while (state_->pending.load(std::memory_order_acquire) > 0) {
+            if (!pool_.runPendingTask()) {
+                // 在加入了线程预算的线程池线程上等待时让出名额，让其他线程执行组内的任务
+                ThreadBudget::BlockingScope blocking;
+                std::unique_lock<std::mutex> ulock(state_->mtx);
+                state_->done.wait(ulock, [&]() -> bool {
+                    return state_->pending.load(std::memory_order_acquire) == 0;
+                });
+            }
+        }
+        std::lock_guard<std::mutex> guard(state_->mtx);
+        if (state_->exception) {
+            std::exception_ptr e = state_->exception;
+            state_->exception = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    // 取消组内还没执行的任务
+    void cancel() {
+        state_->token.cancel();
+    }
+
+    // 获取任务组的取消令牌
+    const CancellationToken& token() const {
+        return state_->token;
+    }
+private:
+    // 任务组共享状态，任务持有它的shared_ptr，任务组先析构也不会悬空
+    struct State {
+        std::atomic<size_t> pending{0}; // 还没完成的任务数
+        CancellationToken token;
+        std::mutex mtx;
+        std::condition_variable done; // 表示所有任务都已完成
+        std::exception_ptr exception; // 第一个抛出的异常
+
+        void setException(std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                if (!exception) {
+                    exception = e;
+                }
+            }
+            token.cancel();
+        }
+
+        // 最后一个完成的任务负责唤醒等待者
+        void finish() {
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> guard(mtx);
+                done.notify_all();
+            }
+        }
+    };
+
+    // 提交给线程池的任务持有它，任务没有执行就析构（提交失败或被丢弃）时记录错误并计数，保证wait能返回
+    struct Guard {
+        explicit Guard(std::shared_ptr<State> s)
+            : state(std::move(s)), error("task group task dropped"), done(false) {}
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() {
+            if (!done) {
+                state->setException(std::make_exception_ptr(std::runtime_error(error)));
+                state->finish();
+            }
+        }
+
+        std::shared_ptr<State> state;
+        const char* error;
+        bool done; // 任务是否已经执行
+    };
+
+    Pool& pool_;
+    std::shared_ptr<State> state_;
+};
+
+using TaskGroup = BasicTaskGroup<>;
+
+#endif /* taskgroup_h */
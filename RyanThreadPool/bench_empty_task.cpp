@@ -0,0 +1,47 @@
+//
+//  bench_empty_task.cpp
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+// 空任务吞吐量测试：提交大量空任务，测量线程池调度本身的开销
+// g++ bench_empty_task.cpp -std=c++17 -O2 -lpthread && ./a.out > /dev/null
+
+#include "RyanThreadPool.h"
+
+const size_t BENCH_TASKS = 1000000;
+
+// usePost为true时用post提交，否则用submitTask提交
+void bench(int threads, bool usePost) {
+    ThreadPool pool;
+    pool.start(threads);
+
+    std::atomic<size_t> done{0};
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_TASKS; ++i) {
+        if (usePost) {
+            pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        } else {
+            pool.submitTask([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+    }
+    while (done.load() < BENCH_TASKS) {
+        std::this_thread::yield();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double sec = std::chrono::duration<double>(end - begin).count();
+    std::cerr << (usePost ? "post       " : "submitTask ")
+        << "threads: " << threads
+        << " time: " << sec * 1000 << " ms"
+        << " throughput: " << BENCH_TASKS / sec << " tasks/s" << std::endl;
+}
+
+int main() {
+    for (int threads : {1, 2, 4, 8}) {
+        bench(threads, false);
+        bench(threads, true);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+//
+//  bench_fair.cpp
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+// 吵闹邻居测试：租户1一次性提交大量任务，租户2每隔一段时间提交一个任务，
+// 比较先进先出队列和按租户公平调度时，租户2从提交到开始执行的延迟
+// g++ bench_fair.cpp -std=c++17 -O2 -lpthread && ./a.out > /dev/null
+
+#include "RyanThreadPool.h"
+#include "FairQueue.h"
+
+#include <algorithm>
+
+const size_t BENCH_NOISY_TASKS = 200000;
+const size_t BENCH_SAMPLES = 200;
+const int BENCH_GAP_US = 500; // 租户2两次提交之间的间隔
+const int BENCH_WORK_NS = 2000; // 每个任务的执行时间
+
+using Clock = std::chrono::steady_clock;
+
+void work() {
+    auto until = Clock::now() + std::chrono::nanoseconds(BENCH_WORK_NS);
+    while (Clock::now() < until) {}
+}
+
+template<typename Pool>
+void bench(const char* name) {
+    Pool pool;
+    pool.start(std::max(2u, std::thread::hardware_concurrency()));
+
+    TaskMeta noisy;
+    noisy.tenant = 1;
+    TaskMeta light;
+    light.tenant = 2;
+
+    for (size_t i = 0; i < BENCH_NOISY_TASKS; ++i) {
+        pool.post(noisy, work);
+    }
+
+    std::vector<int64_t> lat(BENCH_SAMPLES);
+    std::atomic<size_t> done{0};
+    for (size_t i = 0; i < BENCH_SAMPLES; ++i) {
+        auto t0 = Clock::now();
+        pool.post(light, [&lat, &done, i, t0]() {
+            lat[i] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+            work();
+            done.fetch_add(1, std::memory_order_release);
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(BENCH_GAP_US));
+    }
+    while (done.load(std::memory_order_acquire) < BENCH_SAMPLES) {
+        std::this_thread::yield();
+    }
+    pool.shutdown(ShutdownMode::ABORT);
+
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) { return lat[size_t(p * (BENCH_SAMPLES - 1))]; };
+    std::cerr << name
+        << " p50: " << pct(0.5) << " us"
+        << " p99: " << pct(0.99) << " us"
+        << " max: " << lat.back() << " us" << std::endl;
+}
+
+int main() {
+    bench<ThreadPool>("FifoQueue");
+    bench<BasicThreadPool<FairQueue>>("FairQueue");
+    return 0;
+}
@@ -0,0 +1,67 @@
+//
+//  bench_latency.cpp
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+// 单向交接延迟测试：从提交任务到任务开始执行的时间，比较挂起模式、自旋后挂起模式和忙轮询通道
+// 多核机器上忙轮询线程绑定到1号CPU，生产者在其他CPU上
+// g++ bench_latency.cpp -std=c++17 -O2 -lpthread && ./a.out > /dev/null
+
+#include "RyanThreadPool.h"
+#include "FastLane.h"
+
+#include <algorithm>
+
+const size_t BENCH_SAMPLES = 20000;
+const int BENCH_GAP_US = 20; // 两次提交之间的间隔，让消费线程回到空闲状态
+
+using Clock = std::chrono::steady_clock;
+
+// 提交BENCH_SAMPLES个任务，每个任务记录自己从提交到开始执行的时间
+template<typename Submit>
+void bench(const char* name, Submit submit) {
+    std::vector<int64_t> lat(BENCH_SAMPLES);
+    std::atomic<size_t> done{0};
+    for (size_t i = 0; i < BENCH_SAMPLES; ++i) {
+        auto t0 = Clock::now();
+        while (!submit([&lat, &done, i, t0]() {
+            lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            done.fetch_add(1, std::memory_order_release);
+        })) {}
+        auto until = t0 + std::chrono::microseconds(BENCH_GAP_US);
+        while (Clock::now() < until) {}
+    }
+    while (done.load(std::memory_order_acquire) < BENCH_SAMPLES) {
+        std::this_thread::yield();
+    }
+
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) { return lat[size_t(p * (BENCH_SAMPLES - 1))]; };
+    std::cerr << name
+        << " p50: " << pct(0.5) << " ns"
+        << " p90: " << pct(0.9) << " ns"
+        << " p99: " << pct(0.99) << " ns"
+        << " p99.9: " << pct(0.999) << " ns" << std::endl;
+}
+
+int main() {
+    int cpu = std::thread::hardware_concurrency() > 1 ? 1 : -1;
+    {
+        ThreadPool pool;
+        pool.start(1);
+        bench("ParkWait     ", [&](PoolTask t) { return pool.post(std::move(t)); });
+    }
+    {
+        BasicThreadPool<RingQueue, SpinParkWait, FixedScaling, NoStats> pool;
+        pool.start(1);
+        bench("SpinParkWait ", [&](PoolTask t) { return pool.post(std::move(t)); });
+    }
+    {
+        FastLane lane(FAST_LANE_CAPACITY, cpu);
+        lane.bindProducer();
+        bench("FastLane     ", [&](PoolTask t) { return lane.post(std::move(t)); });
+    }
+    return 0;
+}
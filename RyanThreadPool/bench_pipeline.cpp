@@ -0,0 +1,99 @@
+//
+//  bench_pipeline.cpp
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+// 文件到文件的流水线吞吐量测试：读行 -> 解析 -> 变换 -> 压缩 -> 写文件
+// 线程池会向标准输出打印调试信息，测试结果输出到标准错误：
+// g++ bench_pipeline.cpp -std=c++17 -O2 -lpthread && ./a.out > /dev/null
+
+#include "RyanThreadPool.h"
+#include "Pipeline.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+const size_t BENCH_LINES = 200000;
+const size_t BENCH_BATCH = 256;
+
+// 解析：一行以空格分隔的整数
+std::vector<int> parseLine(std::string line) {
+    std::vector<int> nums;
+    std::istringstream in(line);
+    int x;
+    while (in >> x) {
+        nums.push_back(x);
+    }
+    return nums;
+}
+
+// 变换：前缀和
+std::vector<int> transform(std::vector<int> nums) {
+    for (size_t i = 1; i < nums.size(); ++i) {
+        nums[i] += nums[i - 1];
+    }
+    return nums;
+}
+
+// 压缩：按字节做游程编码
+std::string compress(std::vector<int> nums) {
+    const char* p = reinterpret_cast<const char*>(nums.data());
+    size_t n = nums.size() * sizeof(int);
+    std::string out;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && j - i < 255 && p[j] == p[i]) ++j;
+        out.push_back(char(j - i));
+        out.push_back(p[i]);
+        i = j;
+    }
+    return out;
+}
+
+int main() {
+    const char* inPath = "/tmp/ryan_pipeline_in.txt";
+    const char* outPath = "/tmp/ryan_pipeline_out.bin";
+    {
+        std::ofstream in(inPath);
+        for (size_t i = 0; i < BENCH_LINES; ++i) {
+            for (int j = 0; j < 16; ++j) {
+                in << (i * 31 + j * 7) % 1000 << ' ';
+            }
+            in << '\n';
+        }
+    }
+
+    ThreadPool pool;
+    pool.start(std::thread::hardware_concurrency());
+
+    for (size_t tokens : {1, 2, 4, 8, 16, 32}) {
+        std::ifstream in(inPath);
+        std::ofstream out(outPath, std::ios::binary);
+
+        Pipeline pipe(pool, tokens, BENCH_BATCH);
+        pipe.addStage<std::string>(StageMode::PARALLEL, parseLine)
+            .addStage<std::vector<int>>(StageMode::PARALLEL, transform)
+            .addStage<std::vector<int>>(StageMode::PARALLEL, compress)
+            .addStage<std::string>(StageMode::SERIAL_IN_ORDER, [&](std::string s) {
+                out.write(s.data(), s.size());
+            });
+
+        auto begin = std::chrono::steady_clock::now();
+        pipe.run<std::string>([&](std::string& line) -> bool {
+            return bool(std::getline(in, line));
+        });
+        auto end = std::chrono::steady_clock::now();
+
+        double sec = std::chrono::duration<double>(end - begin).count();
+        std::cerr << "tokens: " << tokens
+            << " time: " << sec * 1000 << " ms"
+            << " throughput: " << BENCH_LINES / sec << " lines/s" << std::endl;
+    }
+
+    std::remove(inPath);
+    std::remove(outPath);
+    return 0;
+}
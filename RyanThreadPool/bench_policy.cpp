@@ -0,0 +1,57 @@
+//
+//  bench_policy.cpp
+//  RyanThreadPool
+//
+//  Created by Ryan Wang.
+//
+
+// 线程池策略开销测试：用空任务吞吐量比较不同策略组合
+// 通过post提交，不创建packaged_task和future，测到的主要是入队、取任务和唤醒的开销
+// g++ bench_policy.cpp -std=c++17 -O2 -lpthread && ./a.out > /dev/null
+
+#include "RyanThreadPool.h"
+
+const size_t BENCH_TASKS = 1000000;
+const int BENCH_THREADS = 4;
+
+template<typename Pool, typename Setup>
+void bench(const char* name, Setup setup) {
+    Pool pool;
+    setup(pool);
+    pool.start(BENCH_THREADS);
+
+    std::atomic<size_t> done{0};
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_TASKS; ++i) {
+        pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < BENCH_TASKS) {
+        std::this_thread::yield();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double sec = std::chrono::duration<double>(end - begin).count();
+    std::cerr << name
+        << " time: " << sec * 1000 << " ms"
+        << " ns/task: " << sec * 1e9 / BENCH_TASKS << std::endl;
+}
+
+int main() {
+    auto none = [](auto&) {};
+
+    bench<FixedThreadPool>("fixed (RingQueue, ParkWait, FixedScaling, NoStats)     ", none);
+    bench<BasicThreadPool<FifoQueue, ParkWait, FixedScaling, NoStats>>(
+        "+ FifoQueue                                            ", none);
+    bench<BasicThreadPool<RingQueue, ParkWait, FixedScaling, AtomicStats>>(
+        "+ AtomicStats                                          ", none);
+    bench<BasicThreadPool<RingQueue, SpinParkWait, FixedScaling, NoStats>>(
+        "+ SpinParkWait                                         ", none);
+    bench<BasicThreadPool<RingQueue, ParkWait, ModeScaling, NoStats>>(
+        "+ ModeScaling (MODE_FIXED)                             ", none);
+    bench<ThreadPool>("ThreadPool (FifoQueue, ParkWait, ModeScaling, NoStats)", none);
+    bench<ThreadPool>("ThreadPool MODE_CACHED                                ", [](ThreadPool& pool) {
+        pool.setMode(PoolMode::MODE_CACHED);
+        pool.setThreadNumMaxThreshHold(BENCH_THREADS);
+    });
+    return 0;
+}
@@ -6,6 +6,14 @@
 //
 
 #include "RyanThreadPool.h"
+#include "ParallelReduce.h"
+#include "FairQueue.h"
+#include "FastLane.h"
+#include "Pipeline.h"
+#include "Reactor.h"
+#include "TaskGroup.h"
+
+#include <cassert>
 
 int sum1(int a, int b) {
     std::this_thread::sleep_for(std::chrono::seconds(2));
@@ -17,6 +25,767 @@ int sum2(int a, int b, int c) {
     return a + b + c;
 }
 
+// 并行归约：各内核和标量计算的结果一致，包括不是向量宽度整数倍的尾部和n为0的情况
+// 取值都是0.5的小整数倍，浮点求和没有舍入误差，可以直接比较
+template<typename T, typename Pool>
+void checkReduce(Pool& pool, size_t n) {
+    std::vector<T> a(n), b(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = T(i % 7) / T(2);
+        b[i] = T(i % 3);
+    }
+    if (n > 0) {
+        a[n - 1] = T(-1); // 最小值放在尾部
+        a[n / 2] = T(9);
+    }
+    simd::SumType<T> sum = 0, dot = 0;
+    std::pair<T, T> mm{std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    std::vector<size_t> hist(4, 0);
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i];
+        dot += a[i] * b[i];
+        mm.first = std::min(mm.first, a[i]);
+        mm.second = std::max(mm.second, a[i]);
+        double pos = double(a[i]) * (4 / 3.0); // 区间[0, 3)等分成4个桶
+        ++hist[pos < 0 ? 0 : std::min<size_t>(size_t(pos), 3)];
+    }
+    assert(parallelSum(pool, a.data(), n, 4) == sum);
+    assert(parallelDot(pool, a.data(), b.data(), n, 4) == dot);
+    assert(parallelMinMax(pool, a.data(), n, 4) == mm);
+    assert(parallelHistogram(pool, a.data(), n, T(0), T(3), 4, 4) == hist);
+}
+
+void testParallelReduce() {
+    FixedThreadPool pool;
+    pool.start(3);
+    for (size_t n : {size_t(0), size_t(1), size_t(13), size_t(4096 * 3 + 7), size_t(100003)}) {
+        checkReduce<float>(pool, n);
+        checkReduce<double>(pool, n);
+        checkReduce<int>(pool, n);
+    }
+    
+    // 在唯一的线程上归约：等待块结果时帮忙执行队列中的块，不会死锁
+    ThreadPool one;
+    one.start(1);
+    std::vector<int> data(100000, 1);
+    std::future<long long> res = one.submitTask([&]() {
+        return parallelSum(one, data.data(), data.size(), 4);
+    });
+    assert(res.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    assert(res.get() == 100000);
+    std::cout << "parallel reduce ok" << std::endl;
+}
+
+// 策略：RingQueue回绕后扩容仍按先进先出出队；CachedScaling按需创建线程；AtomicStats计数
+void testPolicies() {
+    RingQueue que;
+    std::vector<int> out;
+    int next = 0;
+    auto pushN = [&](int n) {
+        for (int i = 0; i < n; ++i) {
+            int v = next++;
+            que.push([&out, v]() { out.push_back(v); }, TaskMeta());
+        }
+    };
+    pushN(50);
+    for (int i = 0; i < 30; ++i) {
+        que.pop()();
+    }
+    pushN(100); // 队尾回绕到队头之前，再超出容量触发扩容
+    assert(que.size() == 120);
+    while (!que.empty()) {
+        que.pop()();
+    }
+    assert(out.size() == 150);
+    for (int i = 0; i < 150; ++i) {
+        assert(out[i] == i);
+    }
+    
+    // 初始只有1个线程，4个互相等待的任务只有线程增加到4个才能同时执行
+    BasicThreadPool<RingQueue, SpinParkWait, CachedScaling, AtomicStats> pool;
+    pool.setThreadNumMaxThreshHold(4);
+    pool.start(1);
+    std::mutex mtx;
+    std::condition_variable cond;
+    int arrived = 0;
+    std::vector<std::future<bool>> res;
+    for (int i = 0; i < 4; ++i) {
+        res.emplace_back(pool.submitTask([&]() -> bool {
+            std::unique_lock<std::mutex> ulock(mtx);
+            ++arrived;
+            cond.notify_all();
+            return cond.wait_for(ulock, std::chrono::seconds(5), [&]() -> bool { return arrived == 4; });
+        }));
+    }
+    for (auto& f : res) {
+        assert(f.get());
+    }
+    for (int i = 0; i < 996; ++i) {
+        pool.post([]() {});
+    }
+    pool.shutdown();
+    assert(pool.stats().submitted() == 1000);
+    assert(pool.stats().executed() == 1000);
+    assert(pool.stats().batches() > 0 && pool.stats().batchedTasks() <= 1000);
+    std::cout << "policies ok" << std::endl;
+}
+
+// 没有默认构造函数的返回值类型
+struct NoDefault {
+    explicit NoDefault(int v) : value(v) {}
+    int value;
+};
+
+// 完成回调：返回值、异常、void任务，被ABORT丢弃的任务回调收到broken_promise
+void testCallback() {
+    ThreadPool pool;
+    pool.start(2);
+    
+    std::promise<int> value;
+    assert(pool.submitWithCallback([]() { return NoDefault(5); },
+        [&](std::exception_ptr e, std::optional<NoDefault> v) {
+            value.set_value(!e && v ? v->value : -1);
+        }));
+    assert(value.get_future().get() == 5);
+    
+    std::promise<bool> error;
+    assert(pool.submitWithCallback([]() -> int { throw std::runtime_error("fail"); },
+        [&](std::exception_ptr e, std::optional<int> v) {
+            error.set_value(e != nullptr && !v);
+        }));
+    assert(error.get_future().get());
+    
+    std::promise<bool> done;
+    std::atomic_bool ran(false);
+    assert(pool.submitWithCallback([&]() { ran = true; },
+        [&](std::exception_ptr e) { done.set_value(e == nullptr); }));
+    assert(done.get_future().get() && ran);
+    pool.shutdown();
+    
+    // 排在阻塞任务后面的任务被丢弃，回调仍然被调用；提交失败不调用回调
+    pool.start(1);
+    pool.post([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::promise<bool> dropped;
+    assert(pool.submitWithCallback([]() -> int { return 1; },
+        [&](std::exception_ptr e, std::optional<int> v) {
+            bool broken = false;
+            try {
+                if (e) std::rethrow_exception(e);
+            } catch (const std::future_error& fe) {
+                broken = fe.code() == std::future_errc::broken_promise;
+            }
+            dropped.set_value(broken && !v);
+        }));
+    pool.shutdown(ShutdownMode::ABORT);
+    std::future<bool> res = dropped.get_future();
+    assert(res.wait_for(std::chrono::seconds(1)) == std::future_status::ready && res.get());
+    std::atomic_bool called(false);
+    assert(!pool.submitWithCallback([]() {}, [&](std::exception_ptr) { called = true; }));
+    assert(!called);
+    std::cout << "callback ok" << std::endl;
+}
+
+// SPSC队列：满时拒绝、下标回绕后仍按顺序出队；低延迟通道：停止前执行完剩余任务，其他线程不能提交
+void testFastLane() {
+    SpscQueue<int> que(3); // 容量向上取整为4
+    int next = 0, expect = 0;
+    for (int round = 0; round < 100; ++round) {
+        while (que.push(int(next))) {
+            ++next;
+        }
+        assert(next - expect == 4);
+        int v;
+        for (int i = 0; i < 3; ++i) {
+            assert(que.pop(v) && v == expect++);
+        }
+    }
+    int v;
+    while (que.pop(v)) {
+        assert(v == expect++);
+    }
+    assert(expect == next);
+    
+    std::atomic_int sum(0);
+    {
+        FastLane lane(64);
+        assert(lane.running());
+        assert(lane.bindProducer());
+        for (int i = 1; i <= 1000; ++i) {
+            while (!lane.post([&sum, i]() { sum += i; })) {
+                std::this_thread::yield(); // 通道满，等独占线程取走
+            }
+        }
+        std::thread other([&]() {
+            assert(!lane.bindProducer());
+            assert(!lane.post([&sum]() { sum += 1000000; }));
+        });
+        other.join();
+    } // 析构时执行完通道中剩余的任务
+    assert(sum == 500500);
+    std::cout << "fast lane ok" << std::endl;
+}
+
+// 多租户公平调度：租户队列上限、按权重轮询的出队顺序、租户统计
+void testFairQueue() {
+    BasicThreadPool<FairQueue> pool;
+    pool.setAdmissionMode(AdmissionMode::REJECT);
+    pool.setTenant(1, 3);
+    pool.setTenant(2, 1, 6);
+    pool.start(1);
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool release = false;
+    pool.post([&]() {
+        std::unique_lock<std::mutex> ulock(mtx);
+        cond.wait(ulock, [&]() -> bool { return release; });
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    
+    std::vector<uint> order;
+    TaskMeta t1, t2;
+    t1.tenant = 1;
+    t2.tenant = 2;
+    for (int i = 0; i < 6; ++i) {
+        assert(pool.post(t1, [&]() { order.push_back(1); }));
+    }
+    for (int i = 0; i < 6; ++i) {
+        assert(pool.post(t2, [&]() { order.push_back(2); }));
+    }
+    assert(!pool.post(t2, [&]() { order.push_back(2); })); // 租户2的队列已满
+    TenantStats st = pool.tenantStats(2);
+    assert(st.weight == 1 && st.limit == 6 && st.queued == 6 && st.submitted == 6 && st.rejected == 1);
+    
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        release = true;
+    }
+    cond.notify_all();
+    pool.shutdown();
+    // 租户1每轮取3个，租户2每轮取1个，租户1取完后只剩租户2
+    std::vector<uint> expect{1, 1, 1, 2, 1, 1, 1, 2, 2, 2, 2, 2};
+    assert(order == expect);
+    st = pool.tenantStats(1);
+    assert(st.weight == 3 && st.queued == 0 && st.submitted == 6 && st.dequeued == 6 && st.rejected == 0);
+    std::cout << "fair queue ok" << std::endl;
+}
+
+// 流水线阶段抛出异常：run不会卡住，抛出第一个异常，串行阶段已经输出的记录仍然有序
+void testPipelineError(ThreadPool& pool) {
+    Pipeline pipe(pool, 4, 8);
+    std::vector<int> out;
+    pipe.addStage<int>(StageMode::PARALLEL, [](int x) -> int {
+            if (x == 37) throw std::runtime_error("bad record");
+            return x;
+        })
+        .addStage<int>(StageMode::SERIAL_IN_ORDER, [&](int x) { out.push_back(x); });
+    int i = 0;
+    bool thrown = false;
+    try {
+        pipe.run<int>([&](int& x) -> bool { x = i++; return i <= 1000; });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    for (size_t k = 0; k < out.size(); ++k) {
+        assert(out[k] == int(k));
+    }
+    
+    // 运行中ABORT关闭线程池：被丢弃的令牌也会流出，run抛出异常而不是一直等待
+    FixedThreadPool fixed;
+    fixed.start(1);
+    BasicPipeline<FixedThreadPool> slow(fixed, 4);
+    slow.addStage<int>(StageMode::PARALLEL, [](int x) -> int {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return x;
+        })
+        .addStage<int>(StageMode::SERIAL_IN_ORDER, [](int) {});
+    std::atomic_bool aborted(false);
+    std::thread runner([&]() {
+        int n = 0;
+        try {
+            slow.run<int>([&](int& x) -> bool { x = n++; return true; });
+        } catch (const std::runtime_error&) {
+            aborted = true;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    fixed.shutdown(ShutdownMode::ABORT);
+    runner.join();
+    assert(aborted);
+    std::cout << "pipeline error ok" << std::endl;
+}
+
+#ifdef __linux__
+// I/O反应堆：唯一的线程阻塞在poll(-1)中时提交的任务仍然执行；管道可读时waitFor完成
+void testReactor() {
+    Reactor reactor;
+    ThreadPool pool;
+    pool.setPoller(&reactor);
+    pool.start(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // 等线程进入poll
+    
+    std::future<int> res = pool.submitTask([]() -> int { return 42; });
+    assert(res.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    assert(res.get() == 42);
+    
+    int fds[2];
+    assert(pipe(fds) == 0);
+    std::future<uint32_t> ready = reactor.waitFor(fds[0], EPOLLIN);
+    assert(ready.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+    assert(write(fds[1], "x", 1) == 1);
+    assert(ready.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    assert(ready.get() & EPOLLIN);
+    
+    pool.shutdown();
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "reactor ok" << std::endl;
+}
+#endif
+
+// 关闭方式、运行时调整线程数量、关闭后重新启动
+void testLifecycle() {
+    // ABORT：正在执行的任务执行完，排队的任务被丢弃，future抛出broken_promise
+    {
+        ThreadPool pool;
+        pool.start(1);
+        std::atomic_bool finished(false);
+        std::future<void> running = pool.submitTask([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            finished = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::vector<std::future<int>> queued;
+        for (int i = 0; i < 5; ++i) {
+            queued.emplace_back(pool.submitTask([i]() -> int { return i; }));
+        }
+        pool.shutdown(ShutdownMode::ABORT);
+        assert(finished);
+        running.get();
+        for (auto& f : queued) {
+            try {
+                f.get();
+                assert(false);
+            } catch (const std::future_error& e) {
+                assert(e.code() == std::future_errc::broken_promise);
+            }
+        }
+        
+        // 关闭后可以重新启动
+        pool.start(2);
+        assert(pool.submitTask([]() -> int { return 7; }).get() == 7);
+    }
+    
+    // DEADLINE：期限内执行不完的任务被丢弃
+    {
+        ThreadPool pool;
+        pool.start(1);
+        std::atomic_int done(0);
+        std::vector<std::future<void>> res;
+        for (int i = 0; i < 20; ++i) {
+            res.emplace_back(pool.submitTask([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                ++done;
+            }));
+        }
+        pool.shutdown(ShutdownMode::DEADLINE, std::chrono::milliseconds(70));
+        assert(done > 0 && done < 20);
+        int dropped = 0;
+        for (auto& f : res) {
+            try {
+                f.get();
+            } catch (const std::future_error&) {
+                ++dropped;
+            }
+        }
+        assert(done + dropped == 20);
+    }
+    
+    // resize：增加和减少线程数量后所有任务都会执行
+    {
+        ThreadPool pool;
+        pool.start(2);
+        std::atomic_int done(0);
+        auto work = [&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++done;
+        };
+        for (int i = 0; i < 100; ++i) {
+            pool.post(work);
+        }
+        pool.resize(6);
+        for (int i = 0; i < 100; ++i) {
+            pool.post(work);
+        }
+        pool.resize(1);
+        for (int i = 0; i < 100; ++i) {
+            pool.post(work);
+        }
+        // 线程数量不能调整为0，之后提交的任务照常执行
+        pool.resize(0);
+        std::future<int> res = pool.submitTask([]() -> int { return 3; });
+        assert(res.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        assert(res.get() == 3);
+        pool.shutdown();
+        assert(done == 300);
+    }
+    std::cout << "lifecycle ok" << std::endl;
+}
+
+// 延迟创建线程：有空闲线程时不再创建新线程
+void testLazyStart() {
+    FixedThreadPool pool;
+    pool.setLazyStart(true);
+    pool.start(64);
+    std::vector<std::thread::id> ids;
+    for (int i = 0; i < 64; ++i) {
+        ids.push_back(pool.submitTask([]() { return std::this_thread::get_id(); }).get());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2)); // 让线程回到空闲状态
+    }
+    // 线程偶尔还没来得及挂起就有新任务，会多创建一两个线程，但远少于64个
+    std::sort(ids.begin(), ids.end());
+    assert(std::unique(ids.begin(), ids.end()) - ids.begin() <= 4);
+    std::cout << "lazy start ok" << std::endl;
+}
+
+// 任务组：重新抛出第一个异常、取消后跳过未执行的任务、线程池线程上嵌套等待
+void testTaskGroup() {
+    ThreadPool pool;
+    pool.start(2);
+    
+    {
+        TaskGroup group(pool);
+        group.run([]() { throw std::runtime_error("first"); });
+        group.run([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            throw std::logic_error("second");
+        });
+        bool first = false;
+        try {
+            group.wait();
+        } catch (const std::runtime_error&) {
+            first = true;
+        } catch (...) {}
+        assert(first);
+    }
+    
+    {
+        // 两个线程都被占住，取消后排队的任务不再执行
+        std::mutex mtx;
+        std::condition_variable cond;
+        bool release = false;
+        std::vector<std::future<void>> blockers;
+        for (int i = 0; i < 2; ++i) {
+            blockers.emplace_back(pool.submitTask([&]() {
+                std::unique_lock<std::mutex> ulock(mtx);
+                cond.wait(ulock, [&]() -> bool { return release; });
+            }));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        TaskGroup group(pool);
+        std::atomic_int ran(0);
+        for (int i = 0; i < 10; ++i) {
+            group.run([&](const CancellationToken&) { ++ran; });
+        }
+        group.cancel();
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            release = true;
+        }
+        cond.notify_all();
+        group.wait();
+        assert(ran == 0);
+        for (auto& f : blockers) {
+            f.get(); // 等阻塞任务返回，mtx和cond才能销毁
+        }
+    }
+    
+    {
+        // 外层任务在线程池线程上等待内层任务组，线程数少于外层任务数也不会死锁
+        TaskGroup outer(pool);
+        std::atomic_int sum(0);
+        for (int i = 0; i < 4; ++i) {
+            outer.run([&]() {
+                TaskGroup inner(pool);
+                for (int j = 0; j < 8; ++j) {
+                    inner.run([&]() { ++sum; });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+        assert(sum == 32);
+    }
+    
+    {
+        // ABORT丢弃排队的组内任务，wait抛出异常而不是一直等待
+        ThreadPool one;
+        one.start(1);
+        one.post([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        TaskGroup group(one);
+        std::atomic_int ran(0);
+        for (int i = 0; i < 4; ++i) {
+            group.run([&]() { ++ran; });
+        }
+        one.shutdown(ShutdownMode::ABORT);
+        bool thrown = false;
+        try {
+            group.wait();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && ran == 0);
+        
+        // 线程池已关闭，提交失败同样抛出异常
+        TaskGroup rejected(one);
+        rejected.run([&]() { ++ran; });
+        thrown = false;
+        try {
+            rejected.wait();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && ran == 0);
+    }
+    std::cout << "task group ok" << std::endl;
+}
+
+// 任务期限：排在阻塞任务后面的任务开始执行前已经过期，不执行，future抛出timed_out；DeadlineQueue按期限出队
+void testDeadline() {
+    BasicThreadPool<DeadlineQueue> pool;
+    pool.start(1);
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool release = false;
+    pool.post([&]() {
+        std::unique_lock<std::mutex> ulock(mtx);
+        cond.wait(ulock, [&]() -> bool { return release; });
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    
+    auto now = std::chrono::steady_clock::now();
+    std::vector<int> order;
+    TaskMeta late;
+    late.deadline = now + std::chrono::seconds(20);
+    pool.post(late, [&]() { order.push_back(2); });
+    TaskMeta early;
+    early.deadline = now + std::chrono::seconds(10);
+    pool.post(early, [&]() { order.push_back(1); });
+    
+    std::atomic_bool ran(false);
+    TaskMeta expired;
+    expired.deadline = now + std::chrono::milliseconds(10);
+    std::future<int> res = pool.submitTask(expired, [&]() -> int {
+        ran = true;
+        return 1;
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        release = true;
+    }
+    cond.notify_all();
+    pool.shutdown(); // 先等线程退出，任务对象析构后再读取异常
+    bool timedOut = false;
+    try {
+        res.get();
+    } catch (const std::system_error& e) {
+        timedOut = e.code() == std::errc::timed_out;
+    }
+    assert(timedOut && !ran);
+    assert(order.size() == 2 && order[0] == 1 && order[1] == 2);
+    std::cout << "deadline ok" << std::endl;
+}
+
+// 字节预算：预算不足时拒绝或等待，任务执行完或被ABORT丢弃后归还预算
+void testByteBudget() {
+    ByteBudget global(1000);
+    ThreadPool pool;
+    pool.setByteBudget(300);
+    pool.setGlobalByteBudget(&global);
+    pool.setAdmissionMode(AdmissionMode::REJECT);
+    pool.start(1);
+    
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool release = false;
+    auto block = [&]() {
+        std::unique_lock<std::mutex> ulock(mtx);
+        cond.wait(ulock, [&]() -> bool { return release; });
+    };
+    TaskMeta meta;
+    meta.bytes = 100;
+    assert(pool.post(meta, block));
+    assert(pool.post(meta, []() {}));
+    assert(pool.post(meta, []() {}));
+    assert(pool.bytesInFlight() == 300);
+    assert(global.inFlight() == 300);
+    
+    // 本线程池的预算已满，REJECT模式立即拒绝，不声明字节的任务不受影响
+    auto begin = std::chrono::steady_clock::now();
+    assert(!pool.post(meta, []() {}));
+    assert(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(100));
+    assert(global.inFlight() == 300);
+    assert(pool.post([]() {}));
+    
+    // 执行完归还预算
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        release = true;
+    }
+    cond.notify_all();
+    pool.shutdown();
+    assert(pool.bytesInFlight() == 0);
+    assert(global.inFlight() == 0);
+    
+    // ABORT丢弃的任务也归还预算
+    release = false;
+    pool.setByteBudget(10000);
+    pool.start(1);
+    assert(pool.post(meta, block));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 5; ++i) {
+        assert(pool.post(meta, []() {}));
+    }
+    assert(global.inFlight() == 600);
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            release = true;
+        }
+        cond.notify_all();
+    });
+    pool.shutdown(ShutdownMode::ABORT);
+    releaser.join();
+    assert(pool.bytesInFlight() == 0);
+    assert(global.inFlight() == 0);
+    
+    // BLOCK模式下共享预算和本线程池的预算都不足，两段等待共用一个期限，总共只等待1s
+    ByteBudget small(200);
+    ThreadPool blocked;
+    blocked.setByteBudget(100);
+    blocked.setGlobalByteBudget(&small);
+    blocked.start(1);
+    release = false;
+    assert(blocked.post(meta, block));
+    assert(small.acquire(100, std::chrono::milliseconds(0))); // 模拟其他线程池占用的预算
+    std::thread other([&]() {
+        // 0.6s后归还共享预算，之后提交线程卡在本线程池的预算上
+        std::this_thread::sleep_for(std::chrono::milliseconds(600));
+        small.release(100);
+    });
+    begin = std::chrono::steady_clock::now();
+    assert(!blocked.post(meta, []() {}));
+    auto waited = std::chrono::steady_clock::now() - begin;
+    assert(waited >= std::chrono::milliseconds(900) && waited < std::chrono::milliseconds(1500));
+    other.join();
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        release = true;
+    }
+    cond.notify_all();
+    blocked.shutdown();
+    std::cout << "byte budget ok" << std::endl;
+}
+
+// 线程预算：持有名额的任务在BlockingScope中等待同一预算中的任务，名额只有1个也不会死锁
+void testThreadBudget() {
+    ThreadBudget budget(1);
+    ThreadPool pool;
+    pool.setThreadBudget(budget, "test", 1);
+    pool.start(4);
+    std::future<int> res = pool.submitTask([&]() -> int {
+        std::future<int> inner = pool.submitTask([]() -> int { return 5; });
+        ThreadBudget::BlockingScope blocking;
+        return inner.get();
+    });
+    assert(res.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    assert(res.get() == 5);
+    
+    // TaskGroup::wait等待时自动让出名额
+    TaskGroup outer(pool);
+    std::atomic_int sum(0);
+    for (int i = 0; i < 4; ++i) {
+        outer.run([&]() {
+            TaskGroup inner(pool);
+            for (int j = 0; j < 8; ++j) {
+                inner.run([&]() { ++sum; });
+            }
+            inner.wait();
+        });
+    }
+    outer.wait();
+    assert(sum == 32);
+    std::cout << "thread budget ok" << std::endl;
+}
+
+// 按键去重：相同键并发提交只执行一次，执行完后重新执行，ABORT丢弃后相同键拿到新的结果
+void testKeyed() {
+    ThreadPool pool;
+    pool.start(4);
+    std::atomic_int runs(0);
+    std::vector<std::shared_future<int>> res;
+    std::vector<std::thread> callers;
+    std::mutex mtx;
+    for (int i = 0; i < 16; ++i) {
+        callers.emplace_back([&]() {
+            auto f = pool.submitKeyed("object", [&]() -> int {
+                ++runs;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return 42;
+            });
+            std::lock_guard<std::mutex> guard(mtx);
+            res.push_back(f);
+        });
+    }
+    for (auto& t : callers) {
+        t.join();
+    }
+    for (auto& f : res) {
+        assert(f.get() == 42);
+    }
+    assert(runs == 1);
+    assert(pool.keyedTasks() == 0);
+    
+    // 执行完后表项已删除，相同键重新执行
+    assert(pool.submitKeyed("object", [&]() -> int { ++runs; return 7; }).get() == 7);
+    assert(runs == 2);
+    
+    // 异常传给所有等待者，之后相同键可以重新提交
+    auto err = pool.submitKeyed("error", []() -> int { throw std::runtime_error("load fail"); });
+    bool thrown = false;
+    try {
+        err.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(pool.submitKeyed("error", []() -> int { return 1; }).get() == 1);
+    pool.shutdown();
+    
+    // ABORT丢弃排队的任务，重新启动后相同键得到新的结果，而不是broken_promise
+    pool.start(1);
+    pool.post([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto dropped = pool.submitKeyed("object", []() -> int { return 1; });
+    assert(pool.keyedTasks() == 1);
+    pool.shutdown(ShutdownMode::ABORT);
+    assert(pool.keyedTasks() == 0);
+    try {
+        dropped.get();
+        assert(false);
+    } catch (const std::future_error& e) {
+        assert(e.code() == std::future_errc::broken_promise);
+    }
+    pool.start(1);
+    assert(pool.submitKeyed("object", []() -> int { return 2; }).get() == 2);
+    std::cout << "keyed ok" << std::endl;
+}
+
 int main() {
     ThreadPool pool;
 //    pool.setMode(PoolMode::MODE_CACHED);
@@ -52,5 +821,22 @@ int main() {
     std::cout << r4.get() << std::endl;
     std::cout << r5.get() << std::endl;
     
+    testParallelReduce();
+    testPolicies();
+    testCallback();
+    testFastLane();
+    testFairQueue();
+    testPipelineError(pool);
+    testLifecycle();
+    testLazyStart();
+    testTaskGroup();
+    testDeadline();
+    testByteBudget();
+    testThreadBudget();
+    testKeyed();
+#ifdef __linux__
+    testReactor();
+#endif
+    
     return 0;
 }
\ No newline at end of file
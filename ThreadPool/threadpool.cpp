@@ -59,6 +59,22 @@ void ThreadPool::setTaskQueMaxThreshHold(int threshHold) {
 
 // 给线程池提交任务，生产任务
 Result ThreadPool::submitTask(std::shared_ptr<Task> sPtr) {
+    if (!enqueue(sPtr)) {
+        return Result(sPtr, false);
+    }
+    
+    // 返回任务的Result对象
+//    return task->getResult(); // 线程执行完task，task对象就被析构了，依赖于task对象的Result对象也没了，这种方式不行。
+    return Result(sPtr);
+}
+
+// 给线程池提交不需要返回值的任务，不创建Result对象
+bool ThreadPool::post(std::shared_ptr<Task> sPtr) {
+    return enqueue(sPtr);
+}
+
+// 把任务放入任务队列，队列满等待1s仍然放不进去返回false
+bool ThreadPool::enqueue(std::shared_ptr<Task> sPtr) {
     // 获取锁
     std::unique_lock<std::mutex> ulock(taskQueMtx_);
 
@@ -73,7 +89,7 @@ Result ThreadPool::submitTask(std::shared_ptr<Task> sPtr) {
     if (!notFull_.wait_for(ulock, std::chrono::seconds(1), pred)) {
         // 表示等待1s后，条件依然不满足
         std::cerr << "task queue is full, submit task fail." << std::endl;
-        return Result(sPtr, false);
+        return false;
     }
 
     // 将任务添加进任务队列中
@@ -99,10 +115,7 @@ Result ThreadPool::submitTask(std::shared_ptr<Task> sPtr) {
         ++threadNums_;
         ++idleThreadNums_;
     }
-    
-    // 返回任务的Result对象
-//    return task->getResult(); // 线程执行完task，task对象就被析构了，依赖于task对象的Result对象也没了，这种方式不行。
-    return Result(sPtr);
+    return true;
 }
 
 // 启动线程池
@@ -243,6 +256,8 @@ Task::Task()
 void Task::exec() {
     if (result_ != nullptr) {
         result_->setVal(run()); // 这里发生多态调用
+    } else {
+        run(); // 通过post提交的任务没有Result，直接执行
     }
 }
 
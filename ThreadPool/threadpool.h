@@ -206,6 +206,9 @@ public:
 
     // 给线程池提交任务
     Result submitTask(std::shared_ptr<Task> sPtr);
+    
+    // 给线程池提交不需要返回值的任务，不创建Result对象；提交失败返回false
+    bool post(std::shared_ptr<Task> sPtr);
 
     // 启动线程池
     void start(int initThreadNums = std::thread::hardware_concurrency());
@@ -214,6 +217,9 @@ public:
     ThreadPool& operator=(const ThreadPool&) = delete;
 
 private:
+    // 把任务放入任务队列
+    bool enqueue(std::shared_ptr<Task> sPtr);
+    
     // 定义线程函数
     void threadFunc(uint threadid);
     